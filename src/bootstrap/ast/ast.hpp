@@ -1,17 +1,55 @@
 #pragma once
 #include "source/span.hpp"
+#include "source/literal_pool.hpp"
+#include "source/translation_unit.hpp"
+#include "token/token_type.hpp"
+#include "util/arena.hpp"
+#include "util/interner.hpp"
+#include "util/small_vec.hpp"
 #include "visitor.hpp"
+#include <memory>
 #include <vector>
 #include <string>
 
 namespace ast { 
 	struct Ident;
 	struct Stmt;
+	struct Decl;
 	struct Expr;
 	struct Type;
 	struct GenericParam;
 	struct Param;
 	struct UnaryOp;
+
+	/* Nodes are placed in the arena of their ASTRoot, and go away all at once with it.
+	 * Owning a node never deletes it, or runs its destructor. */
+	struct Release {
+		template<typename T>
+		inline void operator()(T*) const {}
+	};
+
+	/* Owns a node in the arena of its ASTRoot. */
+	template<typename T>
+	using Box = std::unique_ptr<T, Release>;
+
+	/* A vector whose elements are in the arena of the tree being built. */
+	template<typename T>
+	using Vec = std::vector<T, ArenaAllocator<T>>;
+
+	/* How often each kind of short child list outgrows its inline space.
+	 * Shown with '-stats'. */
+	inline SpillCounter path_spills("Path");
+	inline SpillCounter expr_spills("ExprVec");
+	inline SpillCounter stmt_spills("StmtVec");
+	inline SpillCounter param_spills("ParamVec");
+	inline SpillCounter generic_spills("GenericParamVec");
+	inline SpillCounter field_spills("StructFieldVec");
+	inline SpillCounter attr_spills("Attributes");
+
+	inline SpillCounter* const spill_counters[] = {
+		&path_spills, &expr_spills, &stmt_spills, &param_spills,
+		&generic_spills, &field_spills, &attr_spills,
+	};
 }
 
 /* A single attribute.
@@ -20,8 +58,9 @@ struct Attr {
 	TokenType ty;
 	Span sp;
 };
-/* A vector of attributes. */
-struct Attributes : std::vector<Attr> {
+/* A vector of attributes.
+ * Items rarely have more than a couple. */
+struct Attributes : SmallVec<Attr, 2, &ast::attr_spills> {
 	
 	bool contains(TokenType ty) {
 		for (auto attr : *this)
@@ -35,8 +74,8 @@ struct Attributes : std::vector<Attr> {
 
 /* An identifier-expression pair. */
 struct IDExprPair {
-	std::unique_ptr<ast::Ident> name;
-	std::unique_ptr<ast::Expr> value;
+	ast::Box<ast::Ident> name;
+	ast::Box<ast::Expr> value;
 
 	IDExprPair() = default;
 	IDExprPair(ast::Ident* name, ast::Expr* val) : name(name), value(val) {}
@@ -48,29 +87,33 @@ enum class Mutability {
 };
 
 
-/* A vector of identifier nodes. */
-using Path = std::vector<std::unique_ptr<ast::Ident>>;
+/* A vector of identifier nodes.
+ * Most paths are a name or two long. */
+using Path = SmallVec<ast::Box<ast::Ident>, 2, &ast::path_spills>;
 
-/* A vector of identifier nodes. */
-using StructFieldVec = std::vector<IDExprPair>;
+/* A vector of struct fields and their values. */
+using StructFieldVec = SmallVec<IDExprPair, 2, &ast::field_spills>;
 
 /* A vector of Type nodes. */
-using TypeVec = std::vector<std::unique_ptr<ast::Type>>;
+using TypeVec = ast::Vec<ast::Box<ast::Type>>;
 /* A vector of statement nodes. */
-using StmtVec = std::vector<std::unique_ptr<ast::Stmt>>;
-/* A vector of expression nodes. */
-using ExprVec = std::vector<std::unique_ptr<ast::Expr>>;
+using StmtVec = SmallVec<ast::Box<ast::Stmt>, 4, &ast::stmt_spills>;
+/* A vector of expression nodes.
+ * Mostly call arguments, of which there are only a few. */
+using ExprVec = SmallVec<ast::Box<ast::Expr>, 2, &ast::expr_spills>;
 /* A vector of generic parameter nodes. */
-using GenericParamVec = std::vector<std::unique_ptr<ast::GenericParam>>;
-/* A vector of parameter nodes. */
-using ParamVec = std::vector<std::unique_ptr<ast::Param>>;
+using GenericParamVec = SmallVec<ast::Box<ast::GenericParam>, 1, &ast::generic_spills>;
 /* A vector of parameter nodes. */
-using UnaryOpVec = std::vector<std::unique_ptr<ast::UnaryOp>>;
+using ParamVec = SmallVec<ast::Box<ast::Param>, 2, &ast::param_spills>;
+/* A vector of unary operator nodes. */
+using UnaryOpVec = ast::Vec<ast::Box<ast::UnaryOp>>;
+/* A vector of declaration nodes. */
+using DeclVec = ast::Vec<ast::Box<ast::Decl>>;
 
 struct FunBlock {
 	Span sp;
 	StmtVec stmts;
-	bool defined;
+	bool defined = false;
 
 	FunBlock() = default;
 
@@ -122,6 +165,11 @@ namespace ast {
 		ExprMod,
 		ExprModEq,
 		ExprExp,
+		ExprExpEq,
+		ExprShl,
+		ExprShr,
+		ExprBitOrEq,
+		ExprBitAndEq,
 		ExprAnd,
 		ExprOr,
 		ExprMemAcc,
@@ -232,7 +280,7 @@ namespace ast {
 		UnaryOpVec uops;
 		Value(NodeType type, Span&& span) : Expr(type, std::move(span)) {}
 		virtual ~Value() = default;
-		inline void add_uop(UnaryOp* uop) { uops.push_back(std::unique_ptr<UnaryOp>(uop)); }
+		inline void add_uop(UnaryOp* uop) { uops.push_back(Box<UnaryOp>(uop)); }
 		virtual std::string accept(Visitor&) const override = 0;
 	};
 
@@ -263,9 +311,10 @@ namespace ast {
 
 	/* A lifetime node. */
 	struct Lifetime : public Node {
-		std::string_view name;
+		/* The interned name, including the quote. */
+		Symbol name;
 
-		Lifetime(std::string_view name, Span& span) : Node(NodeType::Lifetime, std::move(span)),
+		Lifetime(Symbol name, Span& span) : Node(NodeType::Lifetime, std::move(span)),
 			name(name)
 		{}
 
@@ -274,9 +323,10 @@ namespace ast {
 
 	/* An identifier node. */
 	struct Ident : public Node {
-		std::string_view name;
+		/* The interned name. */
+		Symbol name;
 
-		Ident(std::string_view name, Span& span) : Node(NodeType::Ident, std::move(span)),
+		Ident(Symbol name, Span& span) : Node(NodeType::Ident, std::move(span)),
 			name(name)
 		{}
 
@@ -304,7 +354,7 @@ namespace ast {
 
 	/* A generic type parameter node. */
 	struct GenericType : public GenericParam {
-		std::unique_ptr<Type> type;
+		Box<Type> type;
 
 		GenericType(Type* ty, Span& span) : GenericParam(NodeType::GenericType, std::move(span)),
 			type(ty)
@@ -315,7 +365,7 @@ namespace ast {
 
 	/* A generic lifetime parameter node. */
 	struct GenericLifetime : public GenericParam {
-		std::unique_ptr<Lifetime> lf;
+		Box<Lifetime> lf;
 
 		GenericLifetime(Lifetime* lf, Span& span) : GenericParam(NodeType::GenericLifetime, std::move(span)),
 			lf(lf)
@@ -326,8 +376,8 @@ namespace ast {
 
 	/* A parameter node. */
 	struct Param : public Node {
-		std::unique_ptr<Ident> name;
-		std::unique_ptr<Type> type;
+		Box<Ident> name;
+		Box<Type> type;
 
 		Param(Ident* name, Type* type, Span& span) : Node(NodeType::Param, std::move(span)),
 			name(name),
@@ -340,8 +390,8 @@ namespace ast {
 	/* A type and lifetime node.
 	 * Used in variable declaration. */
 	struct TypeWithLifetime : public Node {
-		std::unique_ptr<Type> type;
-		std::unique_ptr<Lifetime> lf;
+		Box<Type> type;
+		Box<Lifetime> lf;
 
 		TypeWithLifetime(Type* type, Lifetime* lf, Span& span) : Node(NodeType::Param, std::move(span)),
 			type(type),
@@ -358,13 +408,18 @@ namespace ast {
 
 	/* A translation unit declaration node. */
 	struct DeclTransUnit : public Decl {
-		std::vector<std::unique_ptr<Decl>> declarations;
+		/* Every node of the tree, and the storage of their child lists.
+		 * Comes first, so it's freed after everything that points into it. */
+		Arena arena;
+		DeclVec declarations;
 
-		explicit DeclTransUnit(const TranslationUnit* tu) : Decl(NodeType::DeclTransUnit, Span(*tu, tu->start_pos(), tu->end_pos())) {}
+		explicit DeclTransUnit(const TranslationUnit* tu) : Decl(NodeType::DeclTransUnit, Span(tu->start_pos(), tu->end_pos())),
+			declarations(ArenaAllocator<Box<Decl>>(arena))
+		{}
 
 		Decl* add_decl(Decl* sub) {
 			if (!sub) return nullptr;
-			declarations.push_back(std::unique_ptr<Decl>(sub));
+			declarations.push_back(Box<Decl>(sub));
 			return declarations.back().get();
 		}
 
@@ -373,10 +428,10 @@ namespace ast {
 
 	/* A module declaration node. */
 	struct DeclModule : public Decl {
-		std::unique_ptr<Path> path;
-		std::vector<std::unique_ptr<Decl>> declarations;
+		Box<Path> path;
+		DeclVec declarations;
 
-		DeclModule(Path* path, std::vector<std::unique_ptr<Decl>>& decls, Span& span) : Decl(NodeType::DeclModule, std::move(span)),
+		DeclModule(Path* path, DeclVec& decls, Span& span) : Decl(NodeType::DeclModule, std::move(span)),
 			path(path),
 			declarations(std::move(decls))
 		{}
@@ -385,7 +440,7 @@ namespace ast {
 			if (!sub)
 				return nullptr;
 			
-			declarations.push_back(std::unique_ptr<Decl>(sub));
+			declarations.push_back(Box<Decl>(sub));
 			return declarations.back().get();
 		}
 
@@ -394,7 +449,7 @@ namespace ast {
 
 	/* TODO:  A module import declaration node. */
 	struct DeclModuleImport : public Decl {
-		std::unique_ptr<Path> path;
+		Box<Path> path;
 		DeclModuleImport(Path* path, Span& span) : Decl(NodeType::DeclModuleImport, std::move(span)),
 			path(path)
 		{}
@@ -403,7 +458,7 @@ namespace ast {
 
 	/* TODO:  A package import declaration node. */
 	struct DeclPackageImport : public Decl {
-		std::unique_ptr<Path> path;
+		Box<Path> path;
 		DeclPackageImport(Path* path, Span& span) : Decl(NodeType::DeclPackageImport, std::move(span)),
 			path(path)
 		{}
@@ -415,10 +470,10 @@ namespace ast {
 	 * Has a Path* type,
 	 * Has an Expr* expr,  */
 	struct DeclVar : public Decl {
-		std::unique_ptr<Ident> name;
-		std::unique_ptr<Lifetime> lf;
-		std::unique_ptr<Type> type;
-		std::unique_ptr<Expr> expr;
+		Box<Ident> name;
+		Box<Lifetime> lf;
+		Box<Type> type;
+		Box<Expr> expr;
 
 		DeclVar(Ident* name, Lifetime* lf, Type* type, Expr* expr, Span& span) : Decl(NodeType::DeclVar, std::move(span)),
 			name(name),
@@ -434,8 +489,8 @@ namespace ast {
 	 * Has an Ident* name,
 	 * Has a Path* type, */
 	struct DeclType : public Decl {
-		std::unique_ptr<Ident> name;
-		std::unique_ptr<Type> type;
+		Box<Ident> name;
+		Box<Type> type;
 
 		DeclType(Ident* name, Type* type, Span& span) : Decl(NodeType::DeclType, std::move(span)),
 			name(name),
@@ -447,7 +502,7 @@ namespace ast {
 
 	/* A 'use' scope declaration node. */
 	struct DeclUse : public Decl {
-		std::unique_ptr<Path> path;
+		Box<Path> path;
 
 		DeclUse(Path* path, Span& span) : Decl(NodeType::DeclUse, std::move(span)),
 			path(path)
@@ -458,10 +513,10 @@ namespace ast {
 
 	/* A function declaration node. */
 	struct DeclFun : public Decl {
-		std::unique_ptr<Ident> name;
+		Box<Ident> name;
 		GenericParamVec generic_params;
 		ParamVec params;
-		std::unique_ptr<Type> ret_type;
+		Box<Type> ret_type;
 		FunBlock block;
 
 		DeclFun(Ident* name, GenericParamVec& generic_params, ParamVec& params, Type* ret, FunBlock& block, Span& span)
@@ -483,7 +538,7 @@ namespace ast {
 
 	/* A return statement node. */
 	struct StmtReturn : public Stmt {
-		std::unique_ptr<Expr> item;
+		Box<Expr> item;
 
 		StmtReturn(Expr* item, Span& span) : Stmt(NodeType::StmtReturn, std::move(span)),
 			item(item)
@@ -510,8 +565,8 @@ namespace ast {
 
 	/* An assignment statement node. */
 	struct ExprAssign : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprAssign(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprAssign, std::move(span)),
 			left(lhs),
@@ -522,8 +577,8 @@ namespace ast {
 
 	/* An assignment expression node. */
 	struct ExprEq : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprEq, std::move(span)),
 			left(lhs),
@@ -534,8 +589,8 @@ namespace ast {
 
 	/* An inequality expression node. */
 	struct ExprNotEq : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprNotEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprNotEq, std::move(span)),
 			left(lhs),
@@ -546,8 +601,8 @@ namespace ast {
 
 	/* An inequality expression node. */
 	struct ExprSumEq : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprSumEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprSumEq, std::move(span)),
 			left(lhs),
@@ -558,8 +613,8 @@ namespace ast {
 
 	/* An inequality expression node. */
 	struct ExprSubEq : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprSubEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprSubEq, std::move(span)),
 			left(lhs),
@@ -570,8 +625,8 @@ namespace ast {
 
 	/* An inequality expression node. */
 	struct ExprMulEq : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprMulEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprMulEq, std::move(span)),
 			left(lhs),
@@ -582,8 +637,8 @@ namespace ast {
 
 	/* An inequality expression node. */
 	struct ExprDivEq : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprDivEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprDivEq, std::move(span)),
 			left(lhs),
@@ -594,8 +649,8 @@ namespace ast {
 
 	/* An inequality expression node. */
 	struct ExprModEq : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprModEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprModEq, std::move(span)),
 			left(lhs),
@@ -606,8 +661,8 @@ namespace ast {
 
 	/* An inequality expression node. */
 	struct ExprLesserEq : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprLesserEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprLesserEq, std::move(span)),
 			left(lhs),
@@ -618,8 +673,8 @@ namespace ast {
 
 	/* An inequality expression node. */
 	struct ExprGreaterEq : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprGreaterEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprGreaterEq, std::move(span)),
 			left(lhs),
@@ -630,8 +685,8 @@ namespace ast {
 
 	/* A sum expression node. */
 	struct ExprLesser : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprLesser(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprLesser, std::move(span)),
 			left(lhs),
@@ -642,8 +697,8 @@ namespace ast {
 
 	/* A sum expression node. */
 	struct ExprGreater : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprGreater(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprGreater, std::move(span)),
 			left(lhs),
@@ -654,8 +709,8 @@ namespace ast {
 
 	/* A sum expression node. */
 	struct ExprSum : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprSum(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprSum, std::move(span)),
 			left(lhs),
@@ -666,8 +721,8 @@ namespace ast {
 
 	/* A subtraction expression node. */
 	struct ExprSub : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprSub(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprSub, std::move(span)),
 			left(lhs),
@@ -678,8 +733,8 @@ namespace ast {
 
 	/* A multiplication expression node. */
 	struct ExprMul : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprMul(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprMul, std::move(span)),
 			left(lhs),
@@ -690,8 +745,8 @@ namespace ast {
 
 	/* A division expression node. */
 	struct ExprDiv : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprDiv(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprDiv, std::move(span)),
 			left(lhs),
@@ -702,8 +757,8 @@ namespace ast {
 
 	/* A division expression node. */
 	struct ExprMod : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprMod(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprMod, std::move(span)),
 			left(lhs),
@@ -714,8 +769,8 @@ namespace ast {
 
 	/* An exponent expression node. */
 	struct ExprExp : public Expr {
-		std::unique_ptr<Expr> base;
-		std::unique_ptr<Expr> exp;
+		Box<Expr> base;
+		Box<Expr> exp;
 
 		ExprExp(Expr* base, Expr* exp, Span& span) : Expr(NodeType::ExprExp, std::move(span)),
 			base(base),
@@ -724,10 +779,70 @@ namespace ast {
 		std::string accept(Visitor&) const override { return std::string(); }
 	};
 
+	/* An exponent assignment expression node. */
+	struct ExprExpEq : public Expr {
+		Box<Expr> left;
+		Box<Expr> right;
+
+		ExprExpEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprExpEq, std::move(span)),
+			left(lhs),
+			right(rhs)
+		{}
+		std::string accept(Visitor&) const override { return std::string(); }
+	};
+
+	/* A left shift expression node. */
+	struct ExprShl : public Expr {
+		Box<Expr> left;
+		Box<Expr> right;
+
+		ExprShl(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprShl, std::move(span)),
+			left(lhs),
+			right(rhs)
+		{}
+		std::string accept(Visitor&) const override { return std::string(); }
+	};
+
+	/* A right shift expression node. */
+	struct ExprShr : public Expr {
+		Box<Expr> left;
+		Box<Expr> right;
+
+		ExprShr(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprShr, std::move(span)),
+			left(lhs),
+			right(rhs)
+		{}
+		std::string accept(Visitor&) const override { return std::string(); }
+	};
+
+	/* A bitwise or assignment expression node. */
+	struct ExprBitOrEq : public Expr {
+		Box<Expr> left;
+		Box<Expr> right;
+
+		ExprBitOrEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprBitOrEq, std::move(span)),
+			left(lhs),
+			right(rhs)
+		{}
+		std::string accept(Visitor&) const override { return std::string(); }
+	};
+
+	/* A bitwise and assignment expression node. */
+	struct ExprBitAndEq : public Expr {
+		Box<Expr> left;
+		Box<Expr> right;
+
+		ExprBitAndEq(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprBitAndEq, std::move(span)),
+			left(lhs),
+			right(rhs)
+		{}
+		std::string accept(Visitor&) const override { return std::string(); }
+	};
+
 	/* An inequality expression node. */
 	struct ExprAnd : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprAnd(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprAnd, std::move(span)),
 			left(lhs),
@@ -738,8 +853,8 @@ namespace ast {
 
 	/* An inequality expression node. */
 	struct ExprOr : public Expr {
-		std::unique_ptr<Expr> left;
-		std::unique_ptr<Expr> right;
+		Box<Expr> left;
+		Box<Expr> right;
 
 		ExprOr(Expr* lhs, Expr* rhs, Span& span) : Expr(NodeType::ExprOr, std::move(span)),
 			left(lhs),
@@ -750,8 +865,8 @@ namespace ast {
 
 	/* A member access expression node. */
 	struct ExprMemAcc : public Expr {
-		std::unique_ptr<Expr> lhs;
-		std::unique_ptr<Ident> rhs;
+		Box<Expr> lhs;
+		Box<Ident> rhs;
 
 		ExprMemAcc(Expr* lhs, Ident* rhs, Span& span) : Expr(NodeType::ExprMemAcc, std::move(span)),
 			lhs(lhs),
@@ -770,13 +885,17 @@ namespace ast {
 		std::string accept(Visitor&) const override { return std::string(); }
 	};
 
-	/* A string value node. */
+	/* A string value node.
+	 * The decoded text is kept in the Translation Unit's LiteralPool. */
 	struct ValueString : public Value {
-		std::string_view value;
+		const LiteralPool* pool;
+		LiteralId id;
 
-		ValueString(std::string_view val, Span& span) : Value(NodeType::ValueString, std::move(span)),
-			value(val)
+		ValueString(const LiteralPool& pool, LiteralId id, Span& span) : Value(NodeType::ValueString, std::move(span)),
+			pool(&pool), id(id)
 		{}
+		/* The decoded text of the string. */
+		inline std::string_view value() const { return pool->string(id); }
 		std::string accept(Visitor&) const override { return std::string(); }
 	};
 
@@ -790,23 +909,31 @@ namespace ast {
 		std::string accept(Visitor&) const override { return std::string(); }
 	};
 
-	/* A integer value node. */
+	/* A integer value node.
+	 * The value is kept in the Translation Unit's LiteralPool. */
 	struct ValueInt : public Value {
-		int64_t value;
+		const LiteralPool* pool;
+		LiteralId id;
 
-		ValueInt(size_t val, Span& span) : Value(NodeType::ValueInt, std::move(span)),
-			value(val)
+		ValueInt(const LiteralPool& pool, LiteralId id, Span& span) : Value(NodeType::ValueInt, std::move(span)),
+			pool(&pool), id(id)
 		{}
+		/* The value of the integer. */
+		inline uint64_t value() const { return pool->integer(id); }
 		std::string accept(Visitor&) const override { return std::string(); }
 	};
 
-	/* A floating point value node. */
+	/* A floating point value node.
+	 * The value is kept in the Translation Unit's LiteralPool. */
 	struct ValueFloat : public Value {
-		double value;
+		const LiteralPool* pool;
+		LiteralId id;
 
-		ValueFloat(double val, Span& span) : Value(NodeType::ValueFloat, std::move(span)),
-			value(val)
+		ValueFloat(const LiteralPool& pool, LiteralId id, Span& span) : Value(NodeType::ValueFloat, std::move(span)),
+			pool(&pool), id(id)
 		{}
+		/* The value of the float. */
+		inline double value() const { return pool->floating(id); }
 		std::string accept(Visitor&) const override { return std::string(); }
 	};
 
@@ -818,7 +945,7 @@ namespace ast {
 
 	/* A value at some path. */
 	struct ValuePath : public Value {
-		std::unique_ptr<Path> path;
+		Box<Path> path;
 
 		ValuePath(Path* path, Span& span) : Value(NodeType::ValuePath, std::move(span)),
 			path(path)
@@ -828,7 +955,7 @@ namespace ast {
 
 	/* A value returned by some function call. */
 	struct ValueFunCall : public Value {
-		std::unique_ptr<Path> name;
+		Box<Path> name;
 		ExprVec args;
 
 		ValueFunCall(Path* name, ExprVec& args, Span& span) : Value(NodeType::ValueFunCall, std::move(span)),
@@ -840,7 +967,7 @@ namespace ast {
 
 	/* An struct creation value node. */
 	struct ValueStruct : public Value {
-		std::unique_ptr<Path> name;
+		Box<Path> name;
 		StructFieldVec fields;
 
 		ValueStruct(Path* name, StructFieldVec& fields, Span& span) : Value(NodeType::ValueStruct, std::move(span)),
@@ -862,7 +989,7 @@ namespace ast {
 
 	/* A value returned by some macro invocation. */
 	struct ValueMacroInvoc : public Value {
-		std::unique_ptr<Path> name;
+		Box<Path> name;
 		ExprVec args;
 
 		ValueMacroInvoc(Path* name, ExprVec& args, Span& span) : Value(NodeType::ValueMacroInvoc, std::move(span)),
@@ -998,7 +1125,7 @@ namespace ast {
 
 	/* A path to a non-primitive type node. */
 	struct TypePath : public Type {
-		std::unique_ptr<Path> path;
+		Box<Path> path;
 		GenericParamVec generics;
 
 		TypePath(Path* path, GenericParamVec& generics, Span& span) : Type(NodeType::TypePath, std::move(span)),
@@ -1022,7 +1149,7 @@ namespace ast {
 
 	/* A reference type node to another type. */
 	struct TypeRef : public Type {
-		std::unique_ptr<Type> type;
+		Box<Type> type;
 		Mutability mut;
 
 		TypeRef(Type* type, Mutability mut, Span& span) : Type(NodeType::TypeRef, std::move(span)),
@@ -1035,7 +1162,7 @@ namespace ast {
 
 	/* A pointer type node to another type. */
 	struct TypePtr : public Type {
-		std::unique_ptr<Type> type;
+		Box<Type> type;
 		Mutability mut;
 
 		TypePtr(Type* type, Mutability mut, Span& span) : Type(NodeType::TypePtr, std::move(span)),
@@ -1048,7 +1175,7 @@ namespace ast {
 
 	/* An unknown-size array slice type node. */
 	struct TypeSlice : public Type {
-		std::unique_ptr<Type> type;
+		Box<Type> type;
 
 		TypeSlice(Type* type, Span& span) : Type(NodeType::TypeSlice, std::move(span)),
 			type(type)
@@ -1059,8 +1186,8 @@ namespace ast {
 
 	/* A fixed size array type node. */
 	struct TypeArray : public Type {
-		std::unique_ptr<Type> type;
-		std::unique_ptr<Expr> len;
+		Box<Type> type;
+		Box<Expr> len;
 
 		TypeArray(Type* type, Expr* len, Span& span) : Type(NodeType::TypeArray, std::move(span)),
 			type(type),
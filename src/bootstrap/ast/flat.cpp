@@ -0,0 +1,304 @@
+#include "flat.hpp"
+
+namespace ast {
+
+	/* Finds the two operands of a binary expression.
+	 * Returns false for every other node. */
+	static bool operands(const Node& node, const Node*& lhs, const Node*& rhs) {
+		switch (node.type) {
+		case NodeType::ExprAssign:		{ auto ex = static_cast<const ExprAssign*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprEq:			{ auto ex = static_cast<const ExprEq*>(&node);			lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprNotEq:		{ auto ex = static_cast<const ExprNotEq*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprLesser:		{ auto ex = static_cast<const ExprLesser*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprLesserEq:	{ auto ex = static_cast<const ExprLesserEq*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprGreater:		{ auto ex = static_cast<const ExprGreater*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprGreaterEq:	{ auto ex = static_cast<const ExprGreaterEq*>(&node);	lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprSum:			{ auto ex = static_cast<const ExprSum*>(&node);			lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprSumEq:		{ auto ex = static_cast<const ExprSumEq*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprSub:			{ auto ex = static_cast<const ExprSub*>(&node);			lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprSubEq:		{ auto ex = static_cast<const ExprSubEq*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprMul:			{ auto ex = static_cast<const ExprMul*>(&node);			lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprMulEq:		{ auto ex = static_cast<const ExprMulEq*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprDiv:			{ auto ex = static_cast<const ExprDiv*>(&node);			lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprDivEq:		{ auto ex = static_cast<const ExprDivEq*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprMod:			{ auto ex = static_cast<const ExprMod*>(&node);			lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprModEq:		{ auto ex = static_cast<const ExprModEq*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprExp:			{ auto ex = static_cast<const ExprExp*>(&node);			lhs = ex->base.get(); rhs = ex->exp.get(); return true; }
+		case NodeType::ExprExpEq:		{ auto ex = static_cast<const ExprExpEq*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprShl:			{ auto ex = static_cast<const ExprShl*>(&node);			lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprShr:			{ auto ex = static_cast<const ExprShr*>(&node);			lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprBitOrEq:		{ auto ex = static_cast<const ExprBitOrEq*>(&node);		lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprBitAndEq:	{ auto ex = static_cast<const ExprBitAndEq*>(&node);	lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprAnd:			{ auto ex = static_cast<const ExprAnd*>(&node);			lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprOr:			{ auto ex = static_cast<const ExprOr*>(&node);			lhs = ex->left.get(); rhs = ex->right.get(); return true; }
+		case NodeType::ExprMemAcc:		{ auto ex = static_cast<const ExprMemAcc*>(&node);		lhs = ex->lhs.get(); rhs = ex->rhs.get(); return true; }
+		default:
+			return false;
+		}
+	}
+
+	/* Copies a linked tree into a FlatTree, parents first. */
+	class Flattener {
+
+		FlatTree& tree;
+
+		/* Adds a node whose fields are filled in once its children are known. */
+		NodeId add(const Node& node) {
+			NodeId id = tree.size();
+			tree.types.push_back(node.type);
+			tree.spans.push_back(node.span);
+			tree.data.emplace_back();
+			return id;
+		}
+
+		inline void set(NodeId id, uint32_t lhs, uint32_t rhs = 0) {
+			tree.data[id] = NodeData{ lhs, rhs };
+		}
+
+		/* Appends a record of fields to the extra array. */
+		uint32_t record(std::initializer_list<uint32_t> fields) {
+			uint32_t index = (uint32_t)tree.extra.size();
+			tree.extra.insert(tree.extra.end(), fields);
+			return index;
+		}
+
+		/* Appends a list of 'count' empty items to the extra array.
+		 * The items are filled in by index as they're flattened, since their
+		 * own lists are appended after it and may move the array. */
+		uint32_t list(size_t count) {
+			if (count == 0)
+				return 0;
+			uint32_t index = (uint32_t)tree.extra.size();
+			tree.extra.push_back((uint32_t)count);
+			tree.extra.resize(tree.extra.size() + count);
+			return index;
+		}
+
+		/* Flattens every node of a vector into a list. */
+		template<typename V>
+		uint32_t nodes(const V& vec) {
+			uint32_t index = list(vec.size());
+			uint32_t slot = index + 1;
+			for (const auto& item : vec) {
+				NodeId id = node(item.get());
+				tree.extra[slot++] = id;
+			}
+			return index;
+		}
+
+		/* The first field of a value, which depends on its type. */
+		uint32_t value(const Value& val) {
+			switch (val.type) {
+				case NodeType::ValueBool:
+					return static_cast<const ValueBool&>(val).value;
+				case NodeType::ValueString:
+					return static_cast<const ValueString&>(val).id;
+				case NodeType::ValueChar:
+					return (uint32_t)static_cast<const ValueChar&>(val).value;
+				case NodeType::ValueInt:
+					return static_cast<const ValueInt&>(val).id;
+				case NodeType::ValueFloat:
+					return static_cast<const ValueFloat&>(val).id;
+				case NodeType::ValuePath:
+					return node(static_cast<const ValuePath&>(val).path.get());
+				case NodeType::ValueFunCall: {
+					auto& call = static_cast<const ValueFunCall&>(val);
+					uint32_t name = node(call.name.get());
+					return record({ name, nodes(call.args) });
+				}
+				case NodeType::ValueMacroInvoc: {
+					auto& invoc = static_cast<const ValueMacroInvoc&>(val);
+					uint32_t name = node(invoc.name.get());
+					return record({ name, nodes(invoc.args) });
+				}
+				case NodeType::ValueStruct: {
+					auto& st = static_cast<const ValueStruct&>(val);
+					uint32_t name = node(st.name.get());
+					// Every field is a name followed by its value
+					uint32_t fields = list(st.fields.size() * 2);
+					uint32_t slot = fields + 1;
+					for (const auto& field : st.fields) {
+						NodeId id = node(field.name.get());
+						tree.extra[slot++] = id;
+						id = node(field.value.get());
+						tree.extra[slot++] = id;
+					}
+					return record({ name, fields });
+				}
+				case NodeType::ValueArray:
+					return nodes(static_cast<const ValueArray&>(val).items);
+				case NodeType::ValueTuple:
+					return nodes(static_cast<const ValueTuple&>(val).items);
+				default:
+					return 0;
+			}
+		}
+
+	public:
+		explicit Flattener(FlatTree& tree) : tree(tree) {}
+
+		NodeId node(const Node* node) {
+			if (!node)
+				return NO_NODE;
+
+			const Node* lhs;
+			const Node* rhs;
+			if (operands(*node, lhs, rhs))
+				return binary(node);
+
+			// Reserved before the children, so parents come first
+			NodeId id = add(*node);
+
+			switch (node->type) {
+				case NodeType::DeclTransUnit:
+					set(id, nodes(static_cast<const DeclTransUnit*>(node)->declarations));
+					break;
+				case NodeType::DeclModule: {
+					auto decl = static_cast<const DeclModule*>(node);
+					uint32_t p = this->node(decl->path.get());
+					set(id, p, nodes(decl->declarations));
+					break;
+				}
+				case NodeType::DeclModuleImport:
+					set(id, this->node(static_cast<const DeclModuleImport*>(node)->path.get()));
+					break;
+				case NodeType::DeclPackageImport:
+					set(id, this->node(static_cast<const DeclPackageImport*>(node)->path.get()));
+					break;
+				case NodeType::DeclUse:
+					set(id, this->node(static_cast<const DeclUse*>(node)->path.get()));
+					break;
+				case NodeType::DeclVar: {
+					auto decl = static_cast<const DeclVar*>(node);
+					uint32_t name = this->node(decl->name.get());
+					uint32_t lf = this->node(decl->lf.get());
+					uint32_t ty = this->node(decl->type.get());
+					uint32_t ex = this->node(decl->expr.get());
+					set(id, name, record({ lf, ty, ex }));
+					break;
+				}
+				case NodeType::DeclType: {
+					auto decl = static_cast<const DeclType*>(node);
+					uint32_t name = this->node(decl->name.get());
+					set(id, name, this->node(decl->type.get()));
+					break;
+				}
+				case NodeType::DeclFun: {
+					auto decl = static_cast<const DeclFun*>(node);
+					uint32_t name = this->node(decl->name.get());
+					uint32_t generics = nodes(decl->generic_params);
+					uint32_t params = nodes(decl->params);
+					uint32_t ret = this->node(decl->ret_type.get());
+					uint32_t stmts = decl->block.defined ? nodes(decl->block.stmts) : NO_NODE;
+					set(id, name, record({ generics, params, ret, stmts, decl->block.sp.lo_bit, decl->block.sp.hi_bit }));
+					break;
+				}
+
+				case NodeType::StmtReturn:
+					set(id, this->node(static_cast<const StmtReturn*>(node)->item.get()));
+					break;
+
+
+				case NodeType::ValueBool:
+				case NodeType::ValueString:
+				case NodeType::ValueChar:
+				case NodeType::ValueInt:
+				case NodeType::ValueFloat:
+				case NodeType::ValueVoid:
+				case NodeType::ValuePath:
+				case NodeType::ValueFunCall:
+				case NodeType::ValueMacroInvoc:
+				case NodeType::ValueStruct:
+				case NodeType::ValueArray:
+				case NodeType::ValueTuple: {
+					auto val = static_cast<const Value*>(node);
+					uint32_t lhs = value(*val);
+					set(id, lhs, nodes(val->uops));
+					break;
+				}
+
+				case NodeType::TypePath: {
+					auto ty = static_cast<const TypePath*>(node);
+					uint32_t p = this->node(ty->path.get());
+					set(id, p, nodes(ty->generics));
+					break;
+				}
+				case NodeType::TypeTuple:
+					set(id, nodes(static_cast<const TypeTuple*>(node)->items));
+					break;
+				case NodeType::TypeRef: {
+					auto ty = static_cast<const TypeRef*>(node);
+					set(id, this->node(ty->type.get()), (uint32_t)ty->mut);
+					break;
+				}
+				case NodeType::TypePtr: {
+					auto ty = static_cast<const TypePtr*>(node);
+					set(id, this->node(ty->type.get()), (uint32_t)ty->mut);
+					break;
+				}
+				case NodeType::TypeSlice:
+					set(id, this->node(static_cast<const TypeSlice*>(node)->type.get()));
+					break;
+				case NodeType::TypeArray: {
+					auto ty = static_cast<const TypeArray*>(node);
+					uint32_t inner = this->node(ty->type.get());
+					set(id, inner, this->node(ty->len.get()));
+					break;
+				}
+
+				case NodeType::Ident:
+					set(id, static_cast<const Ident*>(node)->name);
+					break;
+				case NodeType::Lifetime:
+					set(id, static_cast<const Lifetime*>(node)->name);
+					break;
+				case NodeType::Path:
+					set(id, nodes(static_cast<const ast::Path*>(node)->sub_paths));
+					break;
+				case NodeType::GenericType:
+					set(id, this->node(static_cast<const GenericType*>(node)->type.get()));
+					break;
+				case NodeType::GenericLifetime:
+					set(id, this->node(static_cast<const GenericLifetime*>(node)->lf.get()));
+					break;
+				case NodeType::Param: {
+					auto param = static_cast<const Param*>(node);
+					uint32_t name = this->node(param->name.get());
+					set(id, name, this->node(param->type.get()));
+					break;
+				}
+
+				// Nodes without any fields
+				default:
+					break;
+			}
+			return id;
+		}
+
+	private:
+		/* Flattens a binary expression.
+		 * Chains like 'a + b + c + ...' nest to the left as deep as they're long,
+		 * so the left operands are followed with a loop instead of recursion. */
+		NodeId binary(const Node* node) {
+			std::vector<std::pair<NodeId, const Node*>> spine;
+			const Node* lhs;
+			const Node* rhs;
+			while (node && operands(*node, lhs, rhs)) {
+				spine.emplace_back(add(*node), rhs);
+				node = lhs;
+			}
+
+			// Right operands come after everything on their left, like with recursion
+			NodeId left = this->node(node);
+			for (auto it = spine.rbegin(); it != spine.rend(); ++it) {
+				set(it->first, left, this->node(it->second));
+				left = it->first;
+			}
+			return left;
+		}
+	};
+
+	FlatTree::FlatTree(const DeclTransUnit& root) {
+		Flattener(*this).node(&root);
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "ast.hpp"
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace ast {
+
+	/* The index of a node in a FlatTree. */
+	using NodeId = uint32_t;
+	/* Stands in for a child that's missing, like an omitted return type. */
+	constexpr NodeId NO_NODE = UINT32_MAX;
+
+	/* The two fixed fields every node has.
+	 * What they hold depends on the node's type:
+	 *
+	 *   DeclTransUnit                     lhs: list of decls
+	 *   DeclModule                        lhs: path            rhs: list of decls
+	 *   DeclModuleImport, DeclPackageImport,
+	 *   DeclUse                           lhs: path
+	 *   DeclVar                           lhs: name            rhs: extra [lifetime, type, expr]
+	 *   DeclType                          lhs: name            rhs: type
+	 *   DeclFun                           lhs: name            rhs: extra [generics list, params list,
+	 *                                                                  return type, stmts list, block lo, block hi]
+	 *                                                          the stmts list is NO_NODE without a body
+	 *   StmtReturn                        lhs: expr
+	 *   Expr* (binary)                    lhs: left            rhs: right
+	 *   ExprMemAcc                        lhs: expr            rhs: ident
+	 *   Value*                                                 rhs: list of unary ops
+	 *   ValueBool                         lhs: 0 or 1
+	 *   ValueString, ValueInt, ValueFloat lhs: LiteralId in the Translation Unit's LiteralPool
+	 *   ValueChar                         lhs: code point
+	 *   ValuePath                         lhs: path
+	 *   ValueFunCall, ValueMacroInvoc     lhs: extra [path, list of args]
+	 *   ValueStruct                       lhs: extra [path, list of each field's name followed by its value]
+	 *   ValueArray, ValueTuple            lhs: list of items
+	 *   TypePath                          lhs: path            rhs: list of generics
+	 *   TypeTuple                         lhs: list of types
+	 *   TypeRef, TypePtr                  lhs: type            rhs: Mutability
+	 *   TypeSlice                         lhs: type
+	 *   TypeArray                         lhs: type            rhs: length expr
+	 *   Ident, Lifetime                   lhs: Symbol
+	 *   Path                              lhs: list of idents
+	 *   GenericType                       lhs: type
+	 *   GenericLifetime                   lhs: lifetime
+	 *   Param                             lhs: name            rhs: type
+	 *
+	 * 'extra' and 'list' fields are indices into the tree's extra array.
+	 * A list starts with its length, which is followed by the items. */
+	struct NodeData {
+		uint32_t lhs = 0;
+		uint32_t rhs = 0;
+	};
+
+	/* The items of a list in a FlatTree. */
+	struct NodeList {
+		const uint32_t* first;
+		const uint32_t* last;
+
+		inline const uint32_t* begin() const { return first; }
+		inline const uint32_t* end() const { return last; }
+		inline uint32_t size() const { return (uint32_t)(last - first); }
+		inline uint32_t operator[](uint32_t i) const { return first[i]; }
+	};
+
+	/* A syntax tree stored as flat arrays, instead of linked nodes.
+	 * Every node is an index into the type, span and data columns,
+	 * and children refer to each other by index.
+	 * Anything that doesn't fit into a node's two fields goes into the shared extra array.
+	 * Parents come before their children, and the root is always the first node.
+	 * None of the arrays hold pointers, so the tree can be copied byte for byte. */
+	class FlatTree {
+
+	private:
+		std::vector<NodeType> types;
+		std::vector<Span> spans;
+		std::vector<NodeData> data;
+		/* Child lists and the fields that didn't fit into the nodes.
+		 * Index 0 is always an empty list. */
+		std::vector<uint32_t> extra = { 0 };
+
+		friend class Flattener;
+
+	public:
+		/* The index of the root DeclTransUnit. */
+		static constexpr NodeId ROOT = 0;
+
+		/* Lays out a parsed tree. */
+		explicit FlatTree(const DeclTransUnit& root);
+
+		inline uint32_t size() const { return (uint32_t)types.size(); }
+
+		inline NodeType type(NodeId node) const { return types[node]; }
+		inline const Span& span(NodeId node) const { return spans[node]; }
+		inline const NodeData& at(NodeId node) const { return data[node]; }
+
+		/* Reads a value from the extra array. */
+		inline uint32_t extra_at(uint32_t index) const { return extra[index]; }
+		/* The items of a list in the extra array. */
+		inline NodeList list(uint32_t index) const {
+			const uint32_t* first = &extra[index] + 1;
+			return NodeList{ first, first + extra[index] };
+		}
+	};
+
+	static_assert(std::is_trivially_copyable<NodeData>::value && std::is_trivially_copyable<Span>::value,
+		"flat trees are meant to be copied byte for byte");
+}
@@ -11,35 +11,232 @@
 #if (MAIN_ENTRY)
 
 #include "parser/parser.hpp"
+#include "ast/flat.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
 
 inline void usage() {
 	printf("Usage:\n");
-	printf("    ivy [options] <input>\n\n");
+	printf("    ivy [options] <input>\n");
+	printf("    use '-' as an input to read from the standard input\n\n");
 	printf("Options:\n");
 	printf("    -o <path>    write the output file to the given location\n");
+	printf("    -j <n>       parse up to n files at the same time\n");
+	printf("    -pipeline    lex each file on its own thread while it's parsed\n");
+	printf("    -source-budget <MB>\n");
+	printf("                 keep at most this much source text in memory\n");
 	printf("    -nowarn      suppress compiler warnings\n");
 	printf("    -Werr        treat all warnings as errors\n");
 	printf("    -trace       emit trace messages during compilation\n");
+	printf("    -stats       show how often AST child lists outgrow their inline space\n");
 	printf("    -h           display this help menu\n\n");
 }
 
-bool compile(const std::vector<std::string>& input, const std::string& output) {
-	// TODO: all of the input files need to be parsed
+/* A single file's parse.
+ * Every job has its own ErrorHandler, so jobs can run on any thread. */
+struct ParseJob {
+	TranslationUnit& tu;
+
+	/* Stores the errors emitted while parsing. */
+	DeferredEmitter emitter;
+	/* Makes all of this job's errors. */
+	ErrorHandler handler;
+
+	/* The parsed file, laid out for later passes.
+	 * Might be missing if parsing stopped early. */
+	std::shared_ptr<ast::FlatTree> ast;
+
+	/* Threads that can be used to lex the file, if it's large. */
+	size_t lex_threads = 1;
+	/* Lex on a thread of its own while parsing, instead of lexing up front.
+	 * Always set for streams. */
+	bool pipelined = false;
+
+	/* Stores the errors emitted by the Lexer, when it runs on its own thread. */
+	DeferredEmitter lex_emitter;
+	/* Makes the Lexer's errors, when it runs on its own thread. */
+	ErrorHandler lex_handler;
+
+	/* The most tokens the Lexer can get ahead of the Parser when pipelined. */
+	static constexpr size_t PIPELINE_TOKENS = 1 << 12;
+
+	ParseJob(TranslationUnit& tu, const HandlerFlags& flags)
+		: tu(tu), handler(emitter, flags), lex_handler(lex_emitter, flags) {}
+
+	/* Parses while the Lexer runs on another thread.
+	 * The Lexer stays a bounded number of tokens ahead. */
+	std::shared_ptr<ASTRoot> parse_pipelined(SourceMap& src_map) {
+		SpscRing<Token> ring(PIPELINE_TOKENS);
+		std::thread lexer_thread([&]() {
+			try {
+				Lexer lexer(tu, lex_handler);
+				Token tk;
+				do {
+					tk = lexer.next_token();
+				} while (ring.push(tk) && tk != TokenType::END);
+			}
+			// The error has already been stored by the emitter
+			catch (const CompilerException& e) {}
+			ring.close();
+		});
+
+		// The Lexer has to stop before the ring goes away, even if parsing failed
+		try {
+			Parser parser = Parser(handler, src_map, tu, ring);
+			auto ast = parser.parse();
+			ring.close();
+			lexer_thread.join();
+			return ast;
+		}
+		catch (...) {
+			ring.close();
+			lexer_thread.join();
+			throw;
+		}
+	}
+
+	void run(SourceMap& src_map) {
+		try {
+			std::shared_ptr<ASTRoot> root;
+			if (pipelined) {
+				root = parse_pipelined(src_map);
+			}
+			else {
+				Parser parser = Parser(handler, src_map, tu, lex_threads);
+				root = parser.parse();
+			}
+			// The linked tree is only needed while parsing,
+			// and is freed all at once with its arena
+			ast = std::make_shared<ast::FlatTree>(*root);
+		}
+		// The error has already been stored by the emitter
+		catch (const CompilerException& e) {}
+
+		// Only the first bad sequence is reported, the rest is likely just as broken
+		if (auto pos = tu.utf8_error()) {
+			uint32_t at = tu.start_pos() + *pos;
+			handler.make_error_spanned("invalid UTF-8 in " + tu.filepath(), Span(at, at + 1));
+		}
+
+		// A stream can stop early without the parser noticing
+		if (tu.stream_error() != 0)
+			handler.make_error("failed to read " + tu.filepath() + ": " + strerror(tu.stream_error()));
+
+		// Nothing else reads the text for now
+		src_map.done_with(tu);
+	}
+};
+
+/* Parses every job on a pool of 'jobs' threads.
+ * Files are handed out in order, but may finish in any order. */
+void parse_all(std::vector<std::unique_ptr<ParseJob>>& parse_jobs, SourceMap& src_map, size_t jobs) {
+	std::atomic<size_t> next = 0;
+	auto worker = [&]() {
+		for (size_t i = next++; i < parse_jobs.size(); i = next++)
+			parse_jobs[i]->run(src_map);
+	};
+
+	// No point in having idle threads
+	jobs = std::min(jobs, parse_jobs.size());
+
+	// Run a single job on this thread
+	if (jobs <= 1) {
+		worker();
+		return;
+	}
+
+	std::vector<std::thread> pool;
+	pool.reserve(jobs);
+	for (size_t i = 0; i < jobs; i++)
+		pool.emplace_back(worker);
+	for (auto& t : pool)
+		t.join();
+}
+
+/* Shows how many child lists of each kind had to move out of their node. */
+void print_spill_stats() {
+	printf("-- child lists that outgrew their inline space:\n");
+	for (const SpillCounter* counter : ast::spill_counters) {
+		uint64_t used = counter->used.load(std::memory_order_relaxed);
+		uint64_t spilled = counter->spilled.load(std::memory_order_relaxed);
+		double percent = used > 0 ? 100.0 * spilled / used : 0.0;
+		printf("   %-16s %8lu of %8lu (%.1f%%)\n", counter->name, (unsigned long)spilled, (unsigned long)used, percent);
+	}
+}
+
+bool compile(const std::vector<std::string>& input, const std::string& output, size_t jobs, bool pipeline, bool stats) {
 
 	printf("-- output set to %s\n", output.c_str());
 
 	try {
 		// Must exist outside the Parser
-		SourceMap src_map = SourceMap(Session::handler);
-		std::shared_ptr<ASTRoot> ast;
+		SourceMap& src_map = Session::source_map;
+
+		// Load all of the files before parsing begins
+		// The SourceMap is never changed while parsing
+		std::vector<std::unique_ptr<ParseJob>> parse_jobs;
+		parse_jobs.reserve(input.size());
+		// Streams keep growing while they're parsed,
+		// so they're loaded after all of the files
+		std::vector<std::string> files;
+		std::vector<std::string> streams;
+		for (const auto& path : input)
+			(FileLoader::is_stream(path) ? streams : files).push_back(path);
+
+		std::vector<TranslationUnit*> units = src_map.load_files(files);
+		for (const auto& path : streams)
+			units.push_back(src_map.load_stream(path));
+
+		for (TranslationUnit* tu : units) {
+			// Files that failed to load have already been reported
+			if (!tu)
+				continue;
 
-		// TODO:  Store the AST
-		// FIXME:  This is in a try-catch because 'expressions not implemented yet'
-		try {
-			Parser parser = Parser(src_map, input[0]);
-			ast = parser.parse();
+			// Files given more than once are only parsed once
+			bool seen = std::any_of(parse_jobs.begin(), parse_jobs.end(),
+				[&](const auto& job) { return &job->tu == tu; });
+			if (!seen)
+				parse_jobs.push_back(std::make_unique<ParseJob>(*tu, Session::handler.flags));
+		}
+
+		// Trace messages from multiple threads would be unreadable
+		if (Session::handler.flags.trace)
+			jobs = 1;
+
+		// Threads that aren't needed for whole files can help lex large ones
+		for (auto& job : parse_jobs) {
+			job->lex_threads = std::max<size_t>(1, jobs / parse_jobs.size());
+			// Streams are always pipelined, so parsing starts before all of the input has arrived
+			job->pipelined = pipeline || job->tu.is_streaming();
+		}
+
+		SpillCounter::enabled = stats;
+		parse_all(parse_jobs, src_map, jobs);
+		if (stats)
+			print_spill_stats();
+
+		// Report everything in the order the files were given,
+		// so the output doesn't depend on the number of jobs
+		// A file's lexer errors come before its parser errors, however it was lexed
+		for (auto& job : parse_jobs) {
+			for (auto* emitter : { &job->lex_emitter, &job->emitter }) {
+				for (const auto& err : emitter->emitted()) {
+					try {
+						Session::emitter.emit(err);
+					}
+					catch (const ErrorException& e) {}
+					// FIXME:  This is caught because 'expressions not implemented yet'
+					catch (const InternalException& e) {}
+				}
+			}
+
+			if (job->ast)
+				src_map.add_ast(std::move(job->ast));
+			Session::handler.absorb(job->lex_handler);
+			Session::handler.absorb(job->handler);
 		}
-		catch (const InternalException& e) {}
 
 		if (Session::handler.recount_errors() > 0)
 			Session::handler.emit_delayed();
@@ -74,12 +271,17 @@ int main(int argc, char* argv[]) {
 	std::vector<std::string> input_files;
 	std::string output_file;
 
+	// Use every core unless told otherwise
+	size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+	bool pipeline = false;
+	bool stats = false;
+
 	const std::string cwd = Session::get_cwd();
 
 	for (int i = 1; i < argc; i++) {
 		std::string arg = argv[i];
 		// Handle options
-		if (arg[0] == '-') {
+		if (arg[0] == '-' && arg != "-") {
 			// Show help menu
 			if (arg == "-h") {
 				usage();
@@ -118,6 +320,42 @@ int main(int argc, char* argv[]) {
 				}
 			}
 
+			// Set the number of parallel jobs
+			if (arg == "-j") {
+				if (i + 1 < argc && std::atoi(argv[i+1]) > 0) {
+					jobs = std::atoi(argv[++i]);
+					continue;
+				}
+				else {
+					printf("-j requires a positive number\n");
+					return EXIT_FAILURE;
+				}
+			}
+
+			// Lex and parse on separate threads
+			if (arg == "-pipeline") {
+				pipeline = true;
+				continue;
+			}
+
+			// Count how often child lists spill
+			if (arg == "-stats") {
+				stats = true;
+				continue;
+			}
+
+			// Limit how much source text stays in memory
+			if (arg == "-source-budget") {
+				if (i + 1 < argc && std::atoi(argv[i+1]) > 0) {
+					Session::source_map.set_source_budget((size_t)std::atoi(argv[++i]) << 20);
+					continue;
+				}
+				else {
+					printf("-source-budget requires a positive number of megabytes\n");
+					return EXIT_FAILURE;
+				}
+			}
+
 			// Invalid option
 			else {
 				printf("unrecognized option: %s\n", arg.c_str());
@@ -158,19 +396,19 @@ int main(int argc, char* argv[]) {
 	else if (output_file[output_file.length() - 1] == '/')
 		output_file += "/a.out";
 
-	return compile(input_files, output_file);
+	return compile(input_files, output_file, jobs, pipeline, stats);
 }
 
 
 #else // MAIN_ENTRY
 
 #include "tests/lexer_tests.hpp"
+#include "tests/parser_tests.hpp"
 #include "parser/parser.hpp"
 #include "util/token_info.hpp"
 
 void print_main() {
-	SourceMap sm(Session::handler);
-	Lexer lex(sm.load_file("tests/main.ivy"), handler);
+	Lexer lex(Session::source_map.load_file("tests/main.ivy"), Session::handler);
 
 	Token tk = lex.next_token();
 	while (tk != TokenType::END) {
@@ -189,12 +427,23 @@ int main() {
 	tests::lexer::token_has_correct_absolute_pos();
 	tests::lexer::token_has_correct_line_pos();
 	tests::lexer::token_has_correct_column_pos();
+	tests::lexer::token_on_first_line_has_correct_pos();
+	tests::lexer::unicode_identifier_is_one_token();
+	tests::lexer::unicode_lifetime_is_one_token();
+	tests::lexer::keywords_are_distinguished_from_identifiers();
+	tests::lexer::token_buffer_matches_lexer();
+	tests::lexer::parallel_lexer_matches_lexer();
+	tests::lexer::literals_are_decoded();
+	tests::lexer::identifiers_share_symbols();
+	tests::lexer::relex_matches_full_lex();
+	tests::lexer::edit_rechecks_encoding();
+	tests::lexer::long_text_encoding_errors_are_found();
 	tests::lexer::return_eof_without_translation_unit();
+	tests::parser::unfinished_expression_is_reported();
 
 	// Check error handling
 	// TODO:  Should be moved to a test function at some point
-	SourceMap sm(Session::handler);
-	Lexer lex(sm.load_file("tests/main.ivy"), Session::handler);
+	Lexer lex(Session::source_map.load_file("tests/main.ivy"), Session::handler);
 	Token tk = lex.next_token();
 
 	Error err = Session::handler.new_error(Severity::ERROR, std::string(tk.raw()), tk.span(), 0);
@@ -64,4 +64,6 @@ SysConfig get_curr_system_config() {
 SysConfig Session::sysconf = get_curr_system_config();
 std::string Session::cwd = get_curr_working_dir();
 Emitter Session::emitter = Emitter();
-ErrorHandler Session::handler = ErrorHandler(emitter);
\ No newline at end of file
+ErrorHandler Session::handler = ErrorHandler(emitter);
+SourceMap Session::source_map = SourceMap(handler);
+Interner Session::symbols;
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include "errors/handler.hpp"
+#include "source/source_map.hpp"
+#include "util/interner.hpp"
 
 /* Possible operating systems. */
 enum class OS {
@@ -60,6 +62,14 @@ class Session {
 public:
 	static ErrorHandler handler;
 	static Emitter emitter;
+
+	/* All of the source code in the package.
+	 * Spans are positions in this map. */
+	static SourceMap source_map;
+
+	/* The names of every identifier and lifetime in the package.
+	 * Filled in by the Lexers as they read them. */
+	static Interner symbols;
 	
 	/* Returns a reference to the Session's SysConfig. */
 	static inline const SysConfig& get_sysconf() { return sysconf; }
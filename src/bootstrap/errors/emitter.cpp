@@ -1,5 +1,6 @@
 #include "emitter.hpp"
 #include "source/translation_unit.hpp"
+#include <algorithm>
 
 std::string Emitter::format_error(const Error& err) {
 	std::string build_err;
@@ -24,20 +25,25 @@ std::string Emitter::format_error(const Error& err) {
 	}
 	build_err += "\033[0m\n";
 
+	// Find the lines and columns of the span, only once
+	std::optional<WideSpan> span;
+	if (err.span().has_value())
+		span = err.span()->into_wide();
+
 	// Build sub-messages
 	for (const auto& sub : err.children()) {
 		switch (sub.type) {
 			case SPAN:
 				{
-					if (!err.span().has_value())
+					if (!span.has_value())
 						continue;
 
 					build_err += "\033[4;36m>> ";
 
 					// Add <file>:<line>:<column> to error message
-					if (!err.span()->tu->filepath().empty())
-						build_err += err.span()->tu->filepath() + ":";
-					build_err += std::to_string(err.span()->lo.line) + ":" + std::to_string(err.span()->lo.col);
+					if (!span->tu->filepath().empty())
+						build_err += span->tu->filepath() + ":";
+					build_err += std::to_string(span->lo.line) + ":" + std::to_string(span->lo.col);
 
 					build_err += "\033[0m\n";
 					break;
@@ -45,10 +51,16 @@ std::string Emitter::format_error(const Error& err) {
 
 			case HIGHLIGHT:
 				{
-					if (!err.span().has_value())
+					if (!span.has_value())
 						continue;
 
-					auto line = err.span()->tu->get_line(err.span()->lo.line, false);
+					// Dropped source is read back from its file, which might have changed
+					if (!span->tu->source_intact()) {
+						build_err += "note: the file has changed since it was compiled, so the code can't be shown\033[0m\n";
+						break;
+					}
+
+					auto line = span->tu->get_line(span->lo.line, false);
 
 					int line_prefix = 0;
 					int tabbed_len = 0;
@@ -68,25 +80,28 @@ std::string Emitter::format_error(const Error& err) {
 						size_t pos = 0;
 						while ((pos = line.find("\t")) != line.npos) {
 							line.replace(pos, 1, "    ");
-							if (err.span()->lo.col <= pos && pos <= err.span()->hi.col)
+							if (span->lo.col <= pos && pos <= span->hi.col)
 								tabbed_len += 4;
 							pos += 4;
 						}
 					}
 
 					// TODO:  Multi line spans still look quite stupid.
-					auto linenum_str = std::to_string(err.span()->lo.line);
+					auto linenum_str = std::to_string(span->lo.line);
 					auto linenum_ws = std::string(linenum_str.length(), ' ');
 					build_err += linenum_ws + " |\n";
 					build_err += linenum_str + " | " + line + "\n";
 					build_err += linenum_ws + " | ";
 
+					// Where the line starts in the error message
+					size_t line_start = build_err.length();
 					// The current span's start pos in the error message
-					size_t index = build_err.length() + err.span()->lo.col - 1 - line_prefix;
+					size_t index = line_start + span->lo.col - 1 - line_prefix;
 					// The final length of the error message
-					size_t new_len = err.span()->lo.line == err.span()->hi.line ?
-						index + (err.span()->hi.bit - err.span()->lo.bit) + tabbed_len :	// TRUE
-						index + line.length();												// FALSE
+					// Spans over several lines are marked up to the end of the first one
+					size_t new_len = span->lo.line == span->hi.line ?
+						index + (span->hi.col - span->lo.col) + tabbed_len :	// TRUE
+						std::max(line_start + line.length(), index + 1);		// FALSE
 					
 					build_err.resize(new_len, ' ');
 
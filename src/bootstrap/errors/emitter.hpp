@@ -2,13 +2,14 @@
 #include "error.hpp"
 #include "exceptions.hpp"
 #include <string>
+#include <vector>
 
 /* A small wrapper around formatting and printing error strings. */
 class Emitter {
 
-private:
+protected:
 	/* Keep track of how many errors have been emitted. */
-	size_t emitted_err_count;
+	size_t emitted_err_count = 0;
 
 public:
 	Emitter() = default;
@@ -36,4 +37,35 @@ public:
 	/* Returns a fully formatted error message.
 	 * Compiles the sub-messages and adds coloring. */
 	std::string format_error(const Error&);
+};
+
+/* An Emitter that stores errors instead of printing them.
+ * Used by jobs running on other threads, so their errors can
+ * later be printed by the Session's Emitter in a fixed order.
+ * Throws the same exceptions as the standard Emitter. */
+class DeferredEmitter : public Emitter {
+
+private:
+	/* All of the errors that were emitted, in order. */
+	std::vector<Error> errors;
+
+public:
+	DeferredEmitter() = default;
+
+	/* Store the given 'Error' and throw the matching 'CompilerException'. */
+	void emit(const Error& err) override {
+		// Canceled errors aren't emitted
+		if (err.is_canceled())
+			return;
+
+		errors.push_back(err);
+
+		// Throw exceptions for different error types
+		if (err.is_error()) { emitted_err_count++; throw ErrorException(); }
+		else if (err.is_fatal()) { emitted_err_count++; throw FatalException(); }
+		else if (err.is_bug()) { emitted_err_count++; throw InternalException(); }
+	}
+
+	/* All of the errors emitted so far. */
+	inline const std::vector<Error>& emitted() const { return errors; }
 };
\ No newline at end of file
@@ -3,5 +3,5 @@
 #include "source/translation_unit.hpp"
 
 void Error::emit() const {
-	Session::handler.emit(*this);
+	(owner ? *owner : Session::handler).emit(*this);
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <vector>
 #include <string>
 
+class ErrorHandler;
+
 /* The type of sub-error message. */
 enum SubErrorType {
 	SPAN,
@@ -40,11 +42,18 @@ class Error {
 private:
 	Severity sev;
 	std::string msg;
-	std::optional<WideSpan> sp;
+	/* Where the error is from.
+	 * Only turned into lines and columns once the error is printed,
+	 * since many errors are canceled before that. */
+	std::optional<Span> sp;
 	int id;
 
 	std::vector<SubError> sub_err;
 
+	/* The ErrorHandler that created this error.
+	 * The error is emitted through it, or the Session's if there is none. */
+	ErrorHandler* owner = nullptr;
+
 	/* Add a sub-error to the error.
 	 * The sub-error type specific wrapper functions should be used instead. */
 	inline void sub(SubErrorType ty, const std::string& msg = "") {
@@ -55,7 +64,7 @@ public:
 	Error(Severity lvl, std::string msg, int code = 0)
 		: sev(lvl), msg(std::move(msg)), id(code)
 	{}
-	Error(Severity lvl, std::string msg, const WideSpan& sp, int code = 0)
+	Error(Severity lvl, std::string msg, const Span& sp, int code = 0)
 		: sev(lvl), msg(std::move(msg)), sp(sp), id(code)
 	{}
 
@@ -111,11 +120,11 @@ public:
 	/* Get the main error message. */
 	inline const std::string& message() const			{ return msg; }
 	inline Severity severity() const					{ return sev; }
-	inline const std::optional<WideSpan>& span() const	{ return sp; }
+	inline const std::optional<Span>& span() const	{ return sp; }
 
 	/* Get a vector of all of the sub-errors of this 'Error'. */
 	inline const std::vector<SubError>& children() const	{ return sub_err; }
 
-	/* Emits the error via the 'Emitter'. */
+	/* Emits the error via the 'Emitter' of the ErrorHandler that created it. */
 	void emit() const;
 };
\ No newline at end of file
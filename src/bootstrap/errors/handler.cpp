@@ -33,6 +33,12 @@ void ErrorHandler::emit_delayed() const {
 	}
 }
 
+void ErrorHandler::absorb(ErrorHandler& other) {
+	for (auto& err : other.delayed_errors)
+		err.owner = this;
+	delayed_errors.splice(delayed_errors.end(), other.delayed_errors);
+}
+
 size_t ErrorHandler::recount_errors() {
 	if (!has_errors())
 		return 0;
@@ -35,11 +35,15 @@ public:
 
 	/* Create a new basic error. */
 	inline Error new_error(Severity sev, const std::string& msg, int code) {
-		return Error(sev, msg, code);
+		Error err = Error(sev, msg, code);
+		err.owner = this;
+		return err;
 	}
 	/* Create a new spanned error. */
 	inline Error new_error(Severity sev, const std::string& msg, const Span& sp, int code) {
-		return Error(sev, msg, sp.into_wide(), code);
+		Error err = Error(sev, msg, sp, code);
+		err.owner = this;
+		return err;
 	}
 
 	/* Emit a trace message.
@@ -71,6 +75,10 @@ public:
 	 * Returns the new error count. */
 	size_t recount_errors();
 
+	/* Moves all of the other handler's delayed errors to the back of this one's.
+	 * The moved errors will be emitted through this handler from now on. */
+	void absorb(ErrorHandler& other);
+
 	/* Returns the last error that was pushed back. */
 	inline Error& last() { return delayed_errors.back(); }
 
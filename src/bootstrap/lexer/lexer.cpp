@@ -1,6 +1,12 @@
 #include "lexer.hpp"
+#include "driver/session.hpp"
 #include "util/ranges.hpp"
 #include "util/token_info.hpp"
+#include "util/scan.hpp"
+#include "util/utf8.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <iostream>
 
 /* A single keyword.
@@ -66,48 +72,302 @@ constexpr static const Keyword keywords[] = {
 	{ "priv",		(int)TokenType::PRIV },
 	{ "mut",		(int)TokenType::MUT }
 };
+/* Number of keywords in the keyword array. */
+constexpr size_t KEYWORD_COUNT = sizeof(keywords)/sizeof(*keywords);
+
+/* Finds the length of the shortest or the longest keyword. */
+constexpr size_t keyword_len(bool longest) {
+	size_t len = std::string_view(keywords[0].key).size();
+	for (auto& keyword : keywords) {
+		size_t n = std::string_view(keyword.key).size();
+		if (longest ? n > len : n < len)
+			len = n;
+	}
+	return len;
+}
+
+/* Lengths of the shortest and longest keywords.
+ * Identifiers outside of this range can't be keywords. */
+constexpr size_t KEYWORD_MIN_LEN = keyword_len(false);
+constexpr size_t KEYWORD_MAX_LEN = keyword_len(true);
+static_assert(KEYWORD_MIN_LEN >= 2, "keywords are hashed by their last two characters");
+
+/* Size of the keyword hash table in bits.
+ * The table has 256 slots, which leaves plenty of room for every keyword. */
+constexpr uint32_t KEYWORD_TABLE_BITS = 8;
+static_assert(KEYWORD_COUNT <= 127, "keyword indices have to fit into the table's slots");
+
+/* Hashes a possible keyword from its length and its first and last two characters.
+ * Expects at least 'KEYWORD_MIN_LEN' characters. */
+constexpr uint32_t keyword_hash(const char* key, size_t len, uint32_t seed) {
+	uint32_t hash = seed ^ (uint32_t)len;
+	hash = (hash ^ (unsigned char)key[0]) * 0x01000193;
+	hash = (hash ^ (unsigned char)key[len - 2]) * 0x01000193;
+	hash = (hash ^ (unsigned char)key[len - 1]) * 0x01000193;
+	return hash >> (32 - KEYWORD_TABLE_BITS);
+}
+
+/* Maps hash slots to indices in the keyword array.
+ * Empty slots are -1. */
+struct KeywordTable {
+	uint32_t seed = 0;
+	int8_t slots[1 << KEYWORD_TABLE_BITS] = {};
+};
+
+/* Searches for a seed that gives every keyword its own slot.
+ * Runs at compile time, so a change to the keyword array can't break the lookup silently. */
+constexpr KeywordTable make_keyword_table() {
+	for (uint32_t seed = 0; seed < 1024; seed++) {
+		KeywordTable table;
+		table.seed = seed;
+		for (auto& slot : table.slots)
+			slot = -1;
+
+		bool perfect = true;
+		for (size_t i = 0; i < KEYWORD_COUNT && perfect; i++) {
+			auto key = std::string_view(keywords[i].key);
+			auto slot = keyword_hash(key.data(), key.size(), seed);
+			if (table.slots[slot] != -1)
+				perfect = false;
+			table.slots[slot] = (int8_t)i;
+		}
+
+		if (perfect)
+			return table;
+	}
+	return KeywordTable{ 0xFFFFFFFF, {} };
+}
+
+constexpr static const KeywordTable keyword_table = make_keyword_table();
+static_assert(keyword_table.seed != 0xFFFFFFFF, "no perfect hash seed found for the keyword array");
+
 /* Attempts to find the given key in the keyword array.
+ * Only a single keyword is ever compared with the key.
  * If no keywords match, a nullptr is returned. */
-constexpr const Keyword* key_find(const char* key) {
-	for (unsigned long i = 0; i < sizeof(keywords)/sizeof(*keywords); i++)
-		if (strcmp(keywords[i].key, key) == 0)
-			return &keywords[i];
-	return nullptr;
+constexpr const Keyword* key_find(std::string_view key) {
+	if (key.size() < KEYWORD_MIN_LEN || key.size() > KEYWORD_MAX_LEN)
+		return nullptr;
+
+	auto index = keyword_table.slots[keyword_hash(key.data(), key.size(), keyword_table.seed)];
+	if (index < 0 || key != keywords[index].key)
+		return nullptr;
+	return &keywords[index];
+}
+
+/* A map of operators and punctuation.
+ * Matches a string to a token type.
+ * Single character tokens use the character as the type. */
+constexpr static const Keyword operators[] = {
+	{ ",",		',' },
+	{ ";",		';' },
+	{ "?",		'?' },
+	{ "(",		'(' },
+	{ ")",		')' },
+	{ "{",		'{' },
+	{ "}",		'}' },
+	{ "[",		'[' },
+	{ "]",		']' },
+	{ "~",		'~' },
+	{ "#",		'#' },
+	{ "@",		'@' },
+	{ ".",		'.' },
+	{ "..",		(int)TokenType::DOTDOT },
+	{ "...",	(int)TokenType::DOTDOTDOT },
+	{ ":",		':' },
+	{ "::",		(int)TokenType::SCOPE },
+	{ "=",		'=' },
+	{ "==",		(int)TokenType::EQEQ },
+	{ "=>",		(int)TokenType::FATARROW },
+	{ "!",		'!' },
+	{ "!=",		(int)TokenType::NE },
+	{ "+",		'+' },
+	{ "++",		(int)TokenType::PLUSPLUS },
+	{ "+=",		(int)TokenType::SUME },
+	{ "-",		'-' },
+	{ "--",		(int)TokenType::MINUSMINUS },
+	{ "->",		(int)TokenType::RARROW },
+	{ "-=",		(int)TokenType::SUBE },
+	{ "*",		'*' },
+	{ "*=",		(int)TokenType::MULE },
+	{ "/",		'/' },
+	{ "/=",		(int)TokenType::DIVE },
+	{ "%",		'%' },
+	{ "%=",		(int)TokenType::MODE },
+	{ "^",		'^' },
+	{ "^=",		(int)TokenType::CARE },
+	{ "&",		'&' },
+	{ "&&",		(int)TokenType::AND },
+	{ "&=",		(int)TokenType::ANDE },
+	{ "|",		'|' },
+	{ "||",		(int)TokenType::OR },
+	{ "|=",		(int)TokenType::ORE },
+	{ ">",		'>' },
+	{ ">=",		(int)TokenType::GE },
+	{ ">>",		(int)TokenType::SHR },
+	{ "<",		'<' },
+	{ "<=",		(int)TokenType::LE },
+	{ "<-",		(int)TokenType::LARROW },
+	{ "<->",	(int)TokenType::DARROW },
+	{ "<<",		(int)TokenType::SHL }
+};
+
+/* Limits of the operator state machine.
+ * Columns are the distinct characters operators are made of, plus one for any other character.
+ * States are the distinct prefixes of operators, plus the start state. */
+constexpr size_t OPERATOR_COLUMNS = 32;
+constexpr size_t OPERATOR_STATES = 64;
+
+/* A state machine that recognises the longest operator at the start of some text. */
+struct OperatorDfa {
+	/* Maps every byte to a column in the transition table.
+	 * Bytes that aren't part of any operator map to column 0. */
+	uint8_t columns[256] = {};
+	/* Moves from a state to the next one by the column of the next character.
+	 * State 0 is the start. Moving to it means no operator continues that way. */
+	uint8_t transitions[OPERATOR_STATES][OPERATOR_COLUMNS] = {};
+	/* The token type of the operator that ends in each state.
+	 * 'END' if no operator ends there. */
+	int accepts[OPERATOR_STATES] = {};
+
+	/* The state after reading 'c' in 'state'.
+	 * 0 if no operator continues with 'c'. */
+	constexpr size_t step(size_t state, char c) const { return transitions[state][columns[(unsigned char)c]]; }
+};
+
+/* Builds the operator state machine from the operator array.
+ * Runs at compile time, so too many operators fail the build instead of overflowing. */
+constexpr OperatorDfa make_operator_dfa() {
+	OperatorDfa dfa;
+	size_t column_count = 1;
+	size_t state_count = 1;
+
+	for (auto& op : operators) {
+		size_t state = 0;
+		for (char c : std::string_view(op.key)) {
+			auto& column = dfa.columns[(unsigned char)c];
+			if (column == 0)
+				column = column_count++;
+
+			auto& to = dfa.transitions[state][column];
+			if (to == 0)
+				to = state_count++;
+			state = to;
+		}
+		dfa.accepts[state] = op.value;
+	}
+	return dfa;
+}
+
+/* Checks that the operator that ends in each state is known.
+ * The lexer relies on every prefix of an operator being an operator too. */
+constexpr bool every_state_accepts(const OperatorDfa& dfa) {
+	for (size_t state = 1; state < OPERATOR_STATES; state++)
+		for (size_t col = 0; col < OPERATOR_COLUMNS; col++) {
+			auto to = dfa.transitions[state][col];
+			if (to != 0 && dfa.accepts[to] == (int)TokenType::END)
+				return false;
+		}
+	return true;
 }
 
+constexpr static const OperatorDfa operator_dfa = make_operator_dfa();
+static_assert(every_state_accepts(operator_dfa), "every prefix of an operator has to be an operator");
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////      SourceReader      ///////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-char SourceReader::read_next_char() {
-	// If the current index is out of bounds, return '\0'
- 	if (index >= trans_unit().source().length())
-		return '\0';
+SourceReader::SourceReader(TranslationUnit& tu)
+	: text_start(tu.source().data()), text_end(tu.source().data() + tu.source().size()), translation_unit(tu), cursor(text_start)
+{
+	skip_bom();
+	// Set up the current and next characters
+	refill();
+}
+
+void SourceReader::refill() {
+	// Streamed sources might still have more to read
+	while (cursor + 1 >= text_end && read_more());
 
-	// Return the next character
-	return trans_unit().source()[index];
+	// Stay at the end once EOF has been reached
+	if (cursor > text_end)
+		cursor = text_end;
+
+	curr = cursor < text_end ? cursor[0] : '\0';
+	next = cursor + 1 < text_end ? cursor[1] : '\0';
 }
 
-void SourceReader::bump(int n) {
-	for (int i = 0; i < n; i++) {
-		// Increment reading position
-		if (curr == '\n') {
-			translation_unit.save_newline(index);
-			curr_col = 1;
-			curr_ln++;
-		} else {
-			curr_col++;
-		}
+bool SourceReader::read_more() {
+	if (!translation_unit.fetch_more())
+		return false;
+
+	text_end = text_start + translation_unit.source().size();
+	return true;
+}
 
-		// Move the next character up
-		curr = next;
+char SourceReader::peek_slow(size_t n) {
+	// Streamed sources might still have more to read
+	while (cursor + n >= text_end && read_more());
 
-		if (curr != '\0')
-			index++;
+	return cursor + n < text_end ? cursor[n] : '\0';
+}
 
-		// Read the next character
-		next = read_next_char();
+void SourceReader::skip_whitespace() {
+	// Most runs are a single space, which isn't worth a vector scan
+	if (!range::is_whitespace(next)) {
+		bump();
+		return;
 	}
+
+	// Scan in large steps, and keep going if a stream might have more whitespace
+	do {
+		cursor += scan::whitespace_prefix(rest());
+	} while (cursor == text_end && read_more());
+	refill();
+}
+
+void SourceReader::skip_line() {
+	do {
+		cursor += scan::find_byte(rest(), '\n');
+	} while (cursor == text_end && read_more());
+	refill();
+}
+
+bool SourceReader::skip_past(char a, char b) {
+	while (true) {
+		size_t pos = scan::find_pair(rest(), a, b);
+		if (cursor + pos < text_end) {
+			bump(pos + 2);
+			return true;
+		}
+
+		// The pair might be split between what has been read and what hasn't
+		if (cursor < text_end)
+			cursor = text_end - 1;
+		if (!read_more()) {
+			cursor = text_end;
+			refill();
+			return false;
+		}
+	}
+}
+
+void SourceReader::skip_bom() {
+	// A stream might not have sent the whole mark yet
+	peek(2);
+
+	if (std::string_view(text_start, text_end - text_start).substr(0, 3) == "\xEF\xBB\xBF")
+		cursor = text_start + 3;
+}
+
+uint32_t SourceReader::curr_code_point(int& len) {
+	// A streamed character might not have fully arrived yet
+	size_t need = std::max(utf8::sequence_length(curr), 1);
+	peek(need - 1);
+
+	uint32_t cp;
+	len = utf8::decode(std::string_view(cursor, text_end - cursor), cp);
+	return cp;
 }
 
 
@@ -123,42 +383,38 @@ inline bool is_valid(TokenType tk) { return tk != TokenType::END; }
 inline bool is_valid(int tk) { return tk != (int)TokenType::END; }
 
 void Lexer::consume_ws_and_comments() {
-	// Eat all whitespace
-	while (range::is_whitespace(curr))
-		bump();
+	while (true) {
+		// Eat all whitespace
+		if (range::is_whitespace(curr))
+			skip_whitespace();
 
-	// Eat comments
-	if (curr == '/') {
-		if (next == '/') {
-			save_curr_start();
+		if (curr != '/')
+			return;
 
+		// Eat comments
+		if (next == '/') {
 			// Eat comment until line ends or EOF
-			while (curr != '\n' && curr != '\0') 
-				bump();
-			// Go back and check for whitespace again
-			consume_ws_and_comments();
+			skip_line();
 		}
 		else if (next == '*') {
 			save_curr_start();
 
 			bump(2);
 			// Eat block comment until closed
-			while (true) {
-				// Throw an error if the block is not terminated at the end of the file
-				if (!is_valid(curr)) {
-					handler.emit_fatal_higligted("unterminated block comment", curr_span());
-				}
-				if (curr == '*' && next == '/') { 
-					bump(2);
-					break;
-				}
-				bump();
-			}
+			// Throw an error if the block is not terminated at the end of the file
+			if (!skip_past('*', '/'))
+				handler.emit_fatal_higligted("unterminated block comment", curr_span());
 		}
-		consume_ws_and_comments();
+		else return;
 	}
 }
 
+int Lexer::ident_code_point_len(bool start) {
+	int len;
+	uint32_t cp = curr_code_point(len);
+	return (start ? utf8::is_ident_start(cp) : utf8::is_ident_cont(cp)) ? len : 0;
+}
+
 bool Lexer::scan_hex_escape(unsigned int num, char delim) {
 	bool valid = true;
 	unsigned int number = 0;
@@ -188,8 +444,108 @@ bool Lexer::scan_hex_escape(unsigned int num, char delim) {
 		bump();
 	}
 
-	if (range::is_char(number)) return valid;
-	else return false;
+	if (!utf8::is_scalar(number)) {
+		handler.make_error_higligted("numeric escape is not a valid character", curr_span());
+		return false;
+	}
+	return valid;
+}
+
+/* Decodes the escape sequence after a backslash, and moves 'p' past it.
+ * Expects the escape to be valid. */
+static uint32_t decode_escape(const char*& p) {
+	unsigned int digits = 0;
+	switch (*p++) {
+		case 'n': return '\n';
+		case 'r': return '\r';
+		case 't': return '\t';
+		case 'x': digits = 2; break;
+		case 'u': digits = 4; break;
+		case 'U': digits = 8; break;
+		// Escaped quotes and backslashes are themselves
+		default: return (unsigned char)p[-1];
+	}
+
+	uint32_t cp = 0;
+	for (unsigned int i = 0; i < digits; i++)
+		cp = cp * 16 + range::get_num(*p++, 16).value_or(0);
+	return cp;
+}
+
+Symbol Lexer::intern(std::string_view name) {
+	uint64_t hash = Interner::hash(name);
+	CachedSymbol& cached = symbol_cache[hash & (symbol_cache.size() - 1)];
+	if (cached.name != name) {
+		Symbol sym = symbols.intern(name, hash);
+		cached = CachedSymbol{ symbols.name(sym), sym };
+	}
+	return cached.symbol;
+}
+
+LiteralId Lexer::decode_integer(std::string_view text, int base) {
+	// Skip the base prefix
+	if (base != 10)
+		text.remove_prefix(2);
+
+	uint64_t value = 0;
+	auto [end, err] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+	if (err == std::errc::result_out_of_range) {
+		handler.make_error_higligted("integer literal is too large", curr_span());
+		value = 0;
+	}
+	// Invalid digits have already been reported
+	else if (err != std::errc() || end != text.data() + text.size())
+		value = 0;
+
+	return literals.add_integer(value);
+}
+
+LiteralId Lexer::decode_float(std::string_view text) {
+	double value = 0;
+	auto [end, err] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (err == std::errc::result_out_of_range) {
+		handler.make_error_higligted("float literal is out of range", curr_span());
+		value = 0;
+	}
+	else if (err != std::errc() || end != text.data() + text.size())
+		value = 0;
+
+	return literals.add_float(value);
+}
+
+LiteralId Lexer::decode_char(std::string_view text) {
+	uint32_t cp = 0;
+	if (!text.empty() && text[0] == '\\') {
+		const char* p = text.data() + 1;
+		cp = decode_escape(p);
+	}
+	else utf8::decode(text, cp);
+
+	return literals.add_char(cp);
+}
+
+LiteralId Lexer::decode_string(std::string_view text) {
+	size_t escape = scan::find_byte(text, '\\');
+
+	// Most strings are just their source text
+	if (escape == text.size())
+		return literals.add_string(text);
+
+	decoded.assign(text.data(), escape);
+	const char* p = text.data() + escape;
+	const char* end = text.data() + text.size();
+	while (p < end) {
+		if (*p != '\\') {
+			decoded.push_back(*p++);
+			continue;
+		}
+		p++;
+
+		char buf[4];
+		int len = utf8::encode(decode_escape(p), buf);
+		decoded.append(buf, len);
+	}
+	return literals.copy_string(decoded);
 }
 
 void Lexer::scan_exponent() {
@@ -218,6 +574,7 @@ void Lexer::scan_digits(int base, int full_base) {
 			if (!range::get_num(curr, base).has_value()) {
 				bump();
 				handler.make_error_higligted("invalid digit in base " + std::to_string(base) + " literal", curr_span());
+				continue;
 			}
 			bump();
 		}
@@ -227,10 +584,10 @@ void Lexer::scan_digits(int base, int full_base) {
 
 Token Lexer::lex_number() {
 	int base = 10;
-	size_t start = bitpos();
+	bool is_float = false;
 
 	// Possible binary, ocatal or hex numbers
-	if (curr == 0) {
+	if (curr == '0' && (next == 'b' || next == 'o' || next == 'x')) {
 		bump();
 		switch (curr) {
 			case 'b':
@@ -248,42 +605,62 @@ Token Lexer::lex_number() {
 				base = 16;
 				scan_digits(16, 16);
 				break;
-			default:
-				if (range::is_dec(curr) || curr == '.' || curr == 'e' || curr == 'E') {
-					scan_digits(10, 10);
-				}
-				else return Token(TokenType::LIT_INTEGER, curr_src_view(), curr_span());
+		}
+
+		/* There were no numbers after the base */
+		if (curr_length() == 2) {
+			handler.make_error_higligted("no valid numbers", curr_span());
+			return Token(TokenType::LIT_INTEGER, "0", curr_span(), literals.add_integer(0));
 		}
 	}
 	// Only decimal
-	else if (range::is_dec(curr))
-		scan_digits(10, 10);
+	else scan_digits(10, 10);
 
 	// If there is a dot, it could be a float,
 	// but it could also be a range or followed by a function call
 	// '3.1415' or '0..9' or '42.foo()'
 	if (curr == '.' && range::is_dec(next)) {
+		bump();
 		scan_digits(10, 10);
-		scan_exponent();
+		is_float = true;
 		if (base != 10) {
 			handler.make_error_higligted("only decimal float literals are supported", curr_span());
 		}
 	}
 
-	/* There were no numbers */
-	if (bitpos() == start) {
-		handler.make_error_higligted("no valid numbers", curr_span());
-		return Token(TokenType::LIT_INTEGER, "0", curr_span());
-	}
-
 	if (curr == 'e' || curr == 'E') {
 		scan_exponent();
+		is_float = true;
 		if (base != 10) {
 			handler.make_error_higligted("exponent only supported for decimal numbers", curr_span());
 		}
 	}
 
-	return Token(TokenType::LIT_INTEGER, curr_src_view(), curr_span());
+	auto text = curr_src_view();
+	if (is_float)
+		return Token(TokenType::LIT_FLOAT, text, curr_span(), base == 10 ? decode_float(text) : literals.add_float(0));
+	return Token(TokenType::LIT_INTEGER, text, curr_span(), decode_integer(text, base));
+}
+
+
+Token Lexer::lex_operator() {
+	// Follow the state machine for as long as the operator continues
+	// Every prefix of an operator is an operator too, so it stops on the longest match
+	size_t state = operator_dfa.step(0, curr);
+	size_t len = 1;
+
+	// Most operators end after one or two characters, which are already loaded
+	if (size_t to = operator_dfa.step(state, next)) {
+		state = to;
+		len = 2;
+		while ((to = operator_dfa.step(state, peek(len)))) {
+			state = to;
+			len++;
+		}
+	}
+
+	bump(len);
+	return Token(operator_dfa.accepts[state], curr_src_view(), curr_span());
 }
 
 
@@ -291,6 +668,9 @@ Token Lexer::lex_number() {
 ////////////////////////////////////////      Lexer      //////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+Lexer::Lexer(TranslationUnit& file, ErrorHandler& handler)
+	: SourceReader(file), handler(handler), literals(file.literals()), symbols(Session::symbols) {}
+
 Token Lexer::next_token() {
 	// Get rid of whitespace and comments
 	consume_ws_and_comments();
@@ -298,229 +678,118 @@ Token Lexer::next_token() {
 	// If the current character is EOF, return an END token
 	// It's span is a singel position, since the file ends there
 	if (!is_valid(curr))
-		return Token(TokenType::END, "\\0", Span(trans_unit(), bitpos(), bitpos()));
+		return Token(TokenType::END, "\\0", Span(global_pos(bitpos()), global_pos(bitpos())));
 
 	save_curr_start();
 
 	return next_token_inner();
 }
 
+TokenBuffer Lexer::tokenize_all() {
+	TokenBuffer tokens(translation_unit);
+	// Most tokens and the space around them take a few bytes
+	tokens.reserve(translation_unit.source().size() / 4 + 1);
+
+	while (true) {
+		Token tk = next_token();
+		tokens.push(tk);
+		if (tk == TokenType::END)
+			return tokens;
+	}
+}
+
+Lexer::TokenChange Lexer::relex(TokenBuffer& tokens, const TextEdit& edit) {
+	// Find the first token that could have read any of the edited text
+	size_t first = 0;
+	size_t hi = tokens.size();
+	while (first < hi) {
+		size_t mid = first + (hi - first) / 2;
+		if (tokens.end(mid) + LOOKAHEAD <= edit.offset)
+			first = mid + 1;
+		else
+			hi = mid;
+	}
+
+	// Everything before it stays, so lexing picks up where the token before it ended
+	if (first > 0)
+		seek(tokens.end(first - 1));
+
+	size_t edit_end = edit.offset + edit.inserted.size();
+	size_t old_end = tokens.size();
+	TokenBuffer fresh(translation_unit);
+
+	while (true) {
+		Token tk = next_token();
+		fresh.push(tk);
+		if (tk == TokenType::END)
+			break;
+
+		// Past the edit the text is the same as before, so the old tokens
+		// following one that ends in the same place are still right
+		if (bitpos() >= edit_end) {
+			auto last = tokens.ending_at((uint32_t)(bitpos() - edit.shift()));
+			if (last && *last + 1 < tokens.size()) {
+				old_end = *last + 1;
+				break;
+			}
+		}
+	}
+
+	tokens.splice(first, old_end, fresh, edit.shift());
+	return TokenChange{ first, old_end, first + fresh.size() };
+}
+
 Token Lexer::next_token_inner() {
 	// If it starts like an identifier,
 	// it's either an identifier or a keyword
-	if (range::is_ident_start(curr)) {
-		// String for building words
-		std::string build_str;
-
-		// Build string as long as it could make an identifier
+	if (int len = ident_char_len(true)) {
+		// Bump as long as it could make an identifier
 		do {
-			build_str += curr;
-			bump();
-		} while (range::is_ident_cont(curr));
+			bump(len);
+		} while ((len = ident_char_len(false)));
+
+		auto word = curr_src_view();
 
 		// If only underscore, return
-		if (build_str == "_") return Token('_', curr_src_view(), curr_span());
+		if (word == "_") return Token('_', word, curr_span());
 
 		// Check if the identifier is a keyword
 		// If it is, return a keyword token
-		auto item = key_find(build_str.c_str());
+		auto item = key_find(word);
 		if (item != nullptr)
-			return Token(item->value, curr_src_view(), curr_span());
+			return Token(item->value, word, curr_span());
 
 		// Return string as an identifier
-		return Token(TokenType::ID, curr_src_view(), curr_span());
+		return Token(TokenType::ID, word, curr_span(), intern(word));
 	}
 
 	// If decimal, build number
 	if (range::is_dec(curr))
 		return lex_number();
 
-	// Check for symbol tokens
-	switch (curr) {
-		case ',': bump(); return Token(',', curr_src_view(), curr_span());
-		case ';': bump(); return Token(';', curr_src_view(), curr_span());
-		case '?': bump(); return Token('?', curr_src_view(), curr_span());
-		case '(': bump(); return Token('(', curr_src_view(), curr_span());
-		case ')': bump(); return Token(')', curr_src_view(), curr_span());
-		case '{': bump(); return Token('{', curr_src_view(), curr_span());
-		case '}': bump(); return Token('}', curr_src_view(), curr_span());
-		case '[': bump(); return Token('[', curr_src_view(), curr_span());
-		case ']': bump(); return Token(']', curr_src_view(), curr_span());
-		case '~': bump(); return Token('~', curr_src_view(), curr_span());
-		case '#': bump(); return Token('#', curr_src_view(), curr_span());
-		case '@': bump(); return Token('@', curr_src_view(), curr_span());
-
-		// Very messy cases
-		// Refer to the comments on the side
-		case '.': 
-			if (next == '.') {
-				bump(2);
-				if (curr == '.') {
-					bump();
-					return Token(TokenType::DOTDOTDOT, curr_src_view(), curr_span());		// ...
-				}
-				return Token(TokenType::DOTDOT, curr_src_view(), curr_span());				// ..
-			}
-			else if (!range::is_dec(next)) {
-				bump();
-				return Token('.', curr_src_view(), curr_span());							// .
-			}
-			return lex_number();															// Number
-
-		case ':':
-			if (next == ':') {
-				bump(2);
-				return Token(TokenType::SCOPE, curr_src_view(), curr_span());				// ::
-			}
-			bump();
-			return Token(':', curr_src_view(), curr_span());								// :
-	
-		case '=':
-			if (next == '=') {
-				bump(2);
-				return Token(TokenType::EQEQ, curr_src_view(), curr_span());				// ==
-			}
-			else if (next == '>') {
-				bump(2);
-				return Token(TokenType::FATARROW, curr_src_view(), curr_span());			// =>
-			}
-			bump();
-			return Token('=', curr_src_view(), curr_span());								// =
-
-		case '!':
-			if (next == '=') {
-				bump(2);
-				return Token(TokenType::NE, curr_src_view(), curr_span());					// !=
-			}
-			bump();
-			return Token('!', curr_src_view(), curr_span());								// !
-
-		case '+':
-			if (next == '+') {
-				bump(2);
-				return Token(TokenType::PLUSPLUS, curr_src_view(), curr_span());			// ++
-			}
-			else if (next == '=') {
-				bump(2);
-				return Token(TokenType::SUME, curr_src_view(), curr_span());				// +=
-			}
-			bump();
-			return Token('+', curr_src_view(), curr_span());								// +
-
-		case '-':
-			if (next == '-') {
-				bump(2);
-				return Token(TokenType::MINUSMINUS, curr_src_view(), curr_span());			// --
-			}
-			else if (next == '>') {
-				bump(2);
-				return Token(TokenType::RARROW, curr_src_view(), curr_span());				// ->
-			}
-			else if (next == '=') {
-				bump(2);
-				return Token(TokenType::SUBE, curr_src_view(), curr_span());				// -=
-			}
-			bump();
-			return Token('-', curr_src_view(), curr_span());								// -
-
-		case '*':
-			if (next == '=') {
-				bump(2);
-				return Token(TokenType::MULE, curr_src_view(), curr_span());				// *=
-			}
-			bump();
-			return Token('*', curr_src_view(), curr_span());								// *
-
-		case '/':
-			if (next == '=') {
-				bump(2);
-				return Token(TokenType::DIVE, curr_src_view(), curr_span());				// /=
-			}
-			bump();
-			return Token('/', curr_src_view(), curr_span());								// /
-
-		case '%':
-			if (next == '=') {
-				bump(2);
-				return Token(TokenType::MODE, curr_src_view(), curr_span());				// %=
-			}
-			bump();
-			return Token('%', curr_src_view(), curr_span());								// %
-
-		case '^':
-			if (next == '=') {
-				bump(2);
-				return Token(TokenType::CARE, curr_src_view(), curr_span());				// ^=
-			}
-			bump();
-			return Token('^', curr_src_view(), curr_span());								// ^
-
-		case '&':
-			if (next == '&') {
-				bump(2);
-				return Token(TokenType::AND, curr_src_view(), curr_span());					// &&
-			}
-			if (next == '=') {
-				bump(2);
-				return Token(TokenType::ANDE, curr_src_view(), curr_span());				// &=
-			}
-			bump();
-			return Token('&', curr_src_view(), curr_span());								// &
-
-		case '|':
-			if (next == '|') {
-				bump(2);
-				return Token(TokenType::OR, curr_src_view(), curr_span());					// ||
-			}
-			else if (next == '=') {
-				bump(2);
-				return Token(TokenType::ORE, curr_src_view(), curr_span());					// |=
-			}
-			bump();
-			return Token('|', curr_src_view(), curr_span());								// |
-
-		case '>':
-			if (next == '=') {
-				bump(2);
-				return Token(TokenType::GE, curr_src_view(), curr_span());					// >=
-			}
-			else if (next == '>') {
-				bump(2);
-				return Token(TokenType::SHR, curr_src_view(), curr_span());					// >>
-			}
-			bump();
-			return Token('>', curr_src_view(), curr_span());								// >
-			
-		case '<':
-			switch (next) {
-				case '=':
-					bump(2);
-					return Token(TokenType::LE, curr_src_view(), curr_span());				// <=
-
-				case '-':
-					bump(2);
-					if (curr == '>') { 
-						bump();
-						return Token(TokenType::DARROW, curr_src_view(), curr_span());		// <->
-					}
-					return Token(TokenType::LARROW, curr_src_view(), curr_span());			// <-
-
-				case '<':
-					bump(2);
-					return Token(TokenType::SHL, curr_src_view(), curr_span());				// <<
+	// A dot followed by a digit starts a number
+	if (curr == '.' && range::is_dec(next))
+		return lex_number();
 
-				default:
-					bump();
-					return Token('<', curr_src_view(), curr_span());						// <
-			}
+	// Check for symbol tokens
+	if (range::is_operator(curr))
+		return lex_operator();
 
+	switch (curr) {
 		case '\'':
 		{
 			bump();
 			char c = curr;
 			bool valid = true;
 			size_t start = bitpos();
-			bump();
+
+			// A non-ASCII character is a single symbol, however many bytes it takes
+			int len = 1;
+			if ((unsigned char)c >= 0x80)
+				curr_code_point(len);
+			// Lifetimes are named like identifiers
+			bool ident_start = ident_char_len(true) != 0;
+			bump(len);
 
 			// Character literal is empty
 			if (c == '\'') {
@@ -530,11 +799,11 @@ Token Lexer::next_token_inner() {
 			else {
 				// If it starts like an indentifier and doesnt close,
 				// assume it's a lifetime
-				if (range::is_ident_start(c) && curr != '\'') {
+				if (ident_start && curr != '\'') {
 
 					// Collect lifetime name
-					while (range::is_ident_cont(curr)) {
-						bump();
+					while (int n = ident_char_len(false)) {
+						bump(n);
 					}
 
 					// A lifetime should't end with a '
@@ -546,10 +815,11 @@ Token Lexer::next_token_inner() {
 						auto err = handler.make_fatal_higligted("character literal may contain only one symbol", curr_span());
 						err.add_help("if you meant to create a string literal, use double quotes");
 						err.emit();
-						return Token(TokenType::LIT_STRING, trans_unit().source().substr(start, bitpos() - start - 1), curr_span());
+						auto text = trans_unit().source().substr(start, bitpos() - start - 1);
+						return Token(TokenType::LIT_STRING, text, curr_span(), literals.add_string(text));
 					}
 
-					return Token(TokenType::LF, curr_src_view(), curr_span());
+					return Token(TokenType::LF, curr_src_view(), curr_span(), intern(curr_src_view()));
 				}
 
 				// Newlines and tabs aren't allowed inside characters
@@ -566,6 +836,7 @@ Token Lexer::next_token_inner() {
 						case 't': bump(); break;
 						case '\\': bump(); break;
 						case '\'': bump(); break;
+						case '\"': bump(); break;
 						case 'x': bump(); valid &= scan_hex_escape(2, '\''); break;
 						case 'u': bump(); valid &= scan_hex_escape(4, '\''); break;
 						case 'U': bump(); valid &= scan_hex_escape(8, '\''); break;
@@ -589,7 +860,8 @@ Token Lexer::next_token_inner() {
 							auto err = handler.make_fatal_higligted("character literal may contain only one symbol", curr_span());
 							err.add_help("if you wanted a string literal, use double quotes");
 							err.emit();
-							return Token(TokenType::LIT_STRING, trans_unit().source().substr(start, bitpos() - start - 1), curr_span());
+							auto text = trans_unit().source().substr(start, bitpos() - start - 1);
+							return Token(TokenType::LIT_STRING, text, curr_span(), literals.add_string(text));
 						}
 						// The character literal goes to EOF or newline
 						if (!is_valid(curr) || curr == '\n') {
@@ -605,7 +877,7 @@ Token Lexer::next_token_inner() {
 			std::string_view ret = valid ? trans_unit().source().substr(start, bitpos() - start) : std::string_view("0");
 
 			bump(); // move off end quote
-			return Token(TokenType::LIT_CHAR, ret, curr_span());
+			return Token(TokenType::LIT_CHAR, ret, curr_span(), decode_char(ret));
 		}
 
 		case '"':
@@ -631,6 +903,7 @@ Token Lexer::next_token_inner() {
 						case 't': bump(); break;
 						case '\\': bump(); break;
 						case '\'': bump(); break;
+						case '\"': bump(); break;
 						case 'x': bump(); valid &= scan_hex_escape(2, '\"'); break;
 						case 'u': bump(); valid &= scan_hex_escape(4, '\"'); break;
 						case 'U': bump(); valid &= scan_hex_escape(8, '\"'); break;
@@ -646,7 +919,7 @@ Token Lexer::next_token_inner() {
 			std::string_view ret = valid ? trans_unit().source().substr(start, bitpos() - start) : std::string_view("??");
 
 			bump(); // move off end quote
-			return Token(TokenType::LIT_STRING, ret, curr_span());
+			return Token(TokenType::LIT_STRING, ret, curr_span(), decode_string(ret));
 		}
 
 		default:
@@ -1,6 +1,10 @@
 #pragma once
 #include "source/translation_unit.hpp"
 #include "token/token.hpp"
+#include "token/token_buffer.hpp"
+#include "util/interner.hpp"
+#include "util/ranges.hpp"
+#include <array>
 
 /* General Translation Unit reader. 
  * Tracks current reading position.
@@ -10,39 +14,66 @@
 class SourceReader {
 
 private:
-	/* Current absolute position in the read file.
-	 * Coincides with the position of the character 'next'. */
-	size_t index = 0;
+	/* Start of the source text.
+	 * The text never moves, even while a stream is still being read into it. */
+	const char* text_start;
+	/* End of the source text that has been read so far. */
+	const char* text_end;
 
-	/* The current line position in the source file */
-	int curr_ln = 1;
-	/* The current column position in the source file */
-	int curr_col = 1;
+	/* Reads more of a streamed source once the cursor gets close to the end.
+	 * Then sets up 'curr' and 'next', which are '\0' past the end of the source. */
+	void refill();
+
+	/* Reads more of a streamed source.
+	 * Returns false if there's nothing more to read. */
+	bool read_more();
+
+	/* The source text from the cursor to the end of what has been read so far. */
+	inline std::string_view rest() const { return std::string_view(cursor, text_end - cursor); }
 
 protected:
 	/* The file that is being read  */
 	TranslationUnit& translation_unit;
 
+	/* Position of the character 'curr' in the source text. */
+	const char* cursor;
+
 	/* The current character in the source file */
 	char curr = ' ';
 	/* The next character in the source file */
 	char next;
 
-	/* Gets the next character.
-	 * Once EOF has been reached, '\0' will be returned.
-	 * This does not incremet the index.
-	 * The index is managed by 'bump()', which this is a part of. */
-	char read_next_char();
+	/* Moves past the byte order mark, if the source starts with one. */
+	void skip_bom();
+
+	/* Decodes the character that starts at 'curr'.
+	 * Only needed for non-ASCII characters, which can take multiple bytes.
+	 * 'len' is set to the number of bytes in the character. */
+	uint32_t curr_code_point(int& len);
+
+	/* Gets the character 'n' places after 'curr' without moving.
+	 * Once EOF has been reached, '\0' will be returned. */
+	inline char peek(size_t n) {
+		if (cursor + n < text_end)
+			return cursor[n];
+		return peek_slow(n);
+	}
+	/* Same as 'peek()', but reads more of a streamed source if needed. */
+	char peek_slow(size_t n);
+
+	/* Moves past a run of whitespace.
+	 * Expects the current character to be whitespace. */
+	void skip_whitespace();
+	/* Moves to the end of the current line.
+	 * Stops on the '\n', or at EOF if the line doesn't end. */
+	void skip_line();
+	/* Moves past the next occurence of the characters 'a' and 'b' next to each other.
+	 * Returns false if EOF was reached without finding them. */
+	bool skip_past(char a, char b);
 
 public:
 	/* Construct a new SourceReader given a Translation Unit. */
-	explicit SourceReader(TranslationUnit& tu) : translation_unit(tu) {
-		// Set up the next character
-		next = read_next_char();
-		// Bump the next character to the current one
-		// Bump instead of reading again because we want positioning to be updated
-		bump();
-	}
+	explicit SourceReader(TranslationUnit& tu);
 
 	virtual ~SourceReader() = default;
 
@@ -50,7 +81,20 @@ public:
 	 * The reader will move forward by 'n' amount of characters.
 	 * The 'curr' character is set to the value of the 'next' character.
 	 * If no argument is provided, characters are bumped by one. */
-	void bump(int n = 1);
+	inline void bump(int n = 1) {
+		cursor += n;
+		if (cursor + 1 < text_end) {
+			curr = cursor[0];
+			next = cursor[1];
+		}
+		else refill();
+	}
+
+	/* Moves the reader to an absolute position in the Translation Unit. */
+	inline void seek(size_t pos) {
+		cursor = text_start + pos;
+		refill();
+	}
 
 	/* A reference to the current source file */
 	inline const TranslationUnit& trans_unit() const { return translation_unit; }
@@ -62,13 +106,17 @@ public:
 
 	/* Current absolute position in the Translation Unit.
 	 * Coincides with the position of the character 'curr'. */
-	inline size_t bitpos() const { return index - 1; }
+	inline size_t bitpos() const { return cursor - text_start; }
+	/* Converts a position in the Translation Unit into one in the SourceMap. */
+	inline uint32_t global_pos(size_t pos) const { return translation_unit.start_pos() + pos; }
 	/* Current line number.
-	 * Coincides with the position of the character 'curr'. */
-	inline int lineno() const { return curr_ln; }
+	 * Coincides with the position of the character 'curr'.
+	 * Lines aren't tracked while reading, so this looks it up. */
+	inline int lineno() const { return (int)translation_unit.pos_from_index(bitpos()).line; }
 	/* Current column number.
-	 * Coincides with the position of the character 'curr'. */
-	inline int colno() const { return curr_col; }
+	 * Coincides with the position of the character 'curr'.
+	 * Columns aren't tracked while reading, so this looks it up. */
+	inline int colno() const { return (int)translation_unit.pos_from_index(bitpos()).col; }
 };
 
 /* Translation Unit lexer and tokenizer.
@@ -79,6 +127,24 @@ class Lexer : protected SourceReader {
 private:
 	ErrorHandler& handler;
 
+	/* Where the values of literals are decoded into, usually the Translation Unit's. */
+	LiteralPool& literals;
+	/* Where names are interned, usually the Session's symbols. */
+	Interner& symbols;
+
+	/* Space for decoding strings with escapes, before they're copied into the LiteralPool.
+	 * Kept around so it doesn't have to grow for every string. */
+	std::string decoded;
+
+	/* A name that was interned recently. */
+	struct CachedSymbol {
+		std::string_view name;
+		Symbol symbol;
+	};
+	/* Recently interned names, by their hash.
+	 * Most names show up again soon after, so they rarely have to go to the shared Interner. */
+	std::array<CachedSymbol, 256> symbol_cache = {};
+
 	/* The main identification pattern in the tokenization process.
 	 * Accumulates characters and builds tokens according to the language's syntax. */
 	Token next_token_inner();
@@ -91,6 +157,10 @@ protected:
 	 * Returns a 'LIT_INTEGER' or 'LIT_FLOAT' token. */
 	Token lex_number();
 
+	/* Lexes the longest operator or punctuation token at the current position.
+	 * Expects the current character to start one. */
+	Token lex_operator();
+
 	/* Read through any digits.
 	 * Check if they correspont to the given base.
 	 * Any value outside of the 'base' but inside the 'full_base'
@@ -107,6 +177,32 @@ protected:
 	 * Returns wether the escape is valid, */
 	bool scan_hex_escape(unsigned int num, char delim);
 
+	/* Decodes an integer literal in the given base into the LiteralPool.
+	 * Reports literals that don't fit into 64 bits. */
+	LiteralId decode_integer(std::string_view text, int base);
+	/* Decodes a floating point literal into the LiteralPool.
+	 * Reports literals that are out of range. */
+	LiteralId decode_float(std::string_view text);
+	/* Decodes a character literal, without its quotes, into the LiteralPool.
+	 * Expects any escape in it to be valid. */
+	LiteralId decode_char(std::string_view text);
+	/* Decodes a string literal, without its quotes, into the LiteralPool.
+	 * Strings without escapes aren't copied. Expects every escape in it to be valid. */
+	LiteralId decode_string(std::string_view text);
+
+	/* Interns the name of an identifier or lifetime. */
+	Symbol intern(std::string_view name);
+
+	/* Returns the number of bytes in the current character if it can be part of an identifier.
+	 * Returns 0 if it can't. Non-ASCII characters are only decoded when they show up. */
+	inline int ident_char_len(bool start) {
+		if ((unsigned char)curr < 0x80)
+			return range::is_class(curr, start ? range::IDENT_START : range::IDENT_CONT);
+		return ident_code_point_len(start);
+	}
+	/* Same as 'ident_char_len()', for a non-ASCII current character. */
+	int ident_code_point_len(bool start);
+
 	/* Saves the current Span position. */
 	inline void save_curr_start() {
 		curr_start = bitpos();
@@ -115,7 +211,7 @@ protected:
 	/* Returns the current token's span.
 	 * Relies on a correctly set 'curr_start' position. */
 	inline Span curr_span() const {
-		return Span(trans_unit(), curr_start, bitpos());
+		return Span(global_pos(curr_start), global_pos(bitpos()));
 	}
 
 	/* The current tokens's absolute length. */
@@ -124,20 +220,49 @@ protected:
 	inline std::string_view curr_src_view() { return trans_unit().source().substr(curr_start, curr_length()); }
 
 public:
+	/* The furthest past its end that reading a token can look.
+	 * An identifier checks the whole UTF-8 character after it. */
+	static constexpr size_t LOOKAHEAD = 4;
+
+	/* The tokens that were replaced by 'relex()'.
+	 * The old tokens from 'first' up to 'old_end' became the new ones up to 'new_end'. */
+	struct TokenChange {
+		size_t first;
+		size_t old_end;
+		size_t new_end;
+	};
+
 	/* Saved start position of the current token. */
 	size_t curr_start = 0;
 
 public:
 	/* Construct a lexer to work on the provided Translation Unit. */
-	explicit Lexer(TranslationUnit& file, ErrorHandler& handler) : SourceReader(file), handler(handler) {}
+	explicit Lexer(TranslationUnit& file, ErrorHandler& handler);
+	/* Construct a lexer that decodes literals and interns names somewhere other than usual,
+	 * like when its tokens might still be thrown away. */
+	Lexer(TranslationUnit& file, ErrorHandler& handler, LiteralPool& literals, Interner& symbols)
+		: SourceReader(file), handler(handler), literals(literals), symbols(symbols) {}
 	/* Copy constructor */
-	Lexer(const Lexer& other) : SourceReader(other.translation_unit), handler(other.handler) {}
+	Lexer(const Lexer& other) : SourceReader(other.translation_unit), handler(other.handler), literals(other.literals), symbols(other.symbols) {}
 
 	/* Gets the next token.
 	 * Tokens get marked with a type, location and value if necessary.
 	 * Once EOF has been reached, '\0' will be returned. */
 	Token next_token();
 
+	/* Reads all of the remaining tokens into a buffer.
+	 * The buffer ends with the 'END' token. */
+	TokenBuffer tokenize_all();
+
+	/* Updates the tokens of a Translation Unit after an edit, where this lexer works on the edited unit.
+	 * Lexing starts from the last token that the edit can't have changed,
+	 * and stops as soon as a token ends where one of the old tokens did after the edit,
+	 * since everything from there on lexes the same as before. */
+	TokenChange relex(TokenBuffer& tokens, const TextEdit& edit);
+
 	/* A reference to the current source file */
 	inline const TranslationUnit& trans_unit() const { return translation_unit; }
+
+	using SourceReader::seek;
+	using SourceReader::bitpos;
 };
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "parallel_lexer.hpp"
+#include "driver/session.hpp"
+#include "util/scan.hpp"
+#include <thread>
+
+std::optional<size_t> ParallelLexer::Chunk::token_from(size_t pos) const {
+	if (pos == start)
+		return 0;
+
+	if (auto last = tokens.ending_at(pos))
+		return *last + 1;
+	return std::nullopt;
+}
+
+void ParallelLexer::lex_chunk(Chunk& chunk) {
+	// The chunk's diagnostics are only checked for, never reported
+	DeferredEmitter emitter;
+	ErrorHandler checker(emitter);
+
+	try {
+		Lexer lexer(translation_unit, checker, chunk.staging->literals, chunk.staging->symbols);
+		// The first chunk starts after the byte order mark
+		if (chunk.start != 0)
+			lexer.seek(chunk.start);
+		chunk.start = lexer.bitpos();
+
+		while (true) {
+			Token tk = lexer.next_token();
+			if (checker.has_errors())
+				return;
+
+			if (tk == TokenType::END || lexer.curr_start >= chunk.end) {
+				chunk.complete = true;
+				return;
+			}
+			chunk.tokens.push(tk);
+		}
+	}
+	// Fatal diagnostics stop the chunk just like any other
+	catch (const CompilerException& e) {}
+}
+
+bool ParallelLexer::stitch(const std::vector<Chunk>& chunks, TokenBuffer& tokens, Staging& own, std::vector<Origin>& origins) {
+	DeferredEmitter emitter;
+	ErrorHandler checker(emitter);
+
+	try {
+		Lexer lexer(translation_unit, checker, own.literals, own.symbols);
+		size_t pos = lexer.bitpos();
+		size_t k = 0;
+
+		while (true) {
+			const Chunk& chunk = chunks[k];
+
+			// Once the Lexer is somewhere the chunk's lexer has been,
+			// the rest of the chunk's tokens are the right ones
+			if (auto from = chunk.token_from(pos)) {
+				size_t count = chunk.tokens.size();
+				if (*from < count) {
+					origins.push_back(Origin{ tokens.size(), chunk.staging.get() });
+					tokens.append(chunk.tokens, *from, count);
+					pos = chunk.tokens.end(count - 1);
+				}
+
+				if (chunk.complete && k + 1 < chunks.size()) {
+					k++;
+					continue;
+				}
+			}
+
+			// Read a single token wherever the chunk was wrong, or incomplete
+			lexer.seek(pos);
+			Token tk = lexer.next_token();
+			if (checker.has_errors())
+				return false;
+
+			if (origins.empty() || origins.back().staging != &own)
+				origins.push_back(Origin{ tokens.size(), &own });
+			tokens.push(tk);
+			if (tk == TokenType::END)
+				return true;
+			pos = lexer.bitpos();
+
+			// A long comment or literal might cover more than one chunk
+			while (k + 1 < chunks.size() && lexer.curr_start >= chunks[k].end)
+				k++;
+		}
+	}
+	catch (const CompilerException& e) {
+		return false;
+	}
+}
+
+void ParallelLexer::commit(TokenBuffer& tokens, const std::vector<Origin>& origins) {
+	LiteralPool& literals = translation_unit.literals();
+	std::string_view text = translation_unit.source();
+
+	size_t k = 0;
+	for (size_t i = 0; i < tokens.size(); i++) {
+		while (k + 1 < origins.size() && origins[k + 1].first <= i)
+			k++;
+		Staging& from = *origins[k].staging;
+
+		switch (tokens.type(i)) {
+			case (int)TokenType::LIT_INTEGER:
+				tokens.set_payload(i, literals.add_integer(from.literals.integer(tokens.literal(i))));
+				break;
+			case (int)TokenType::LIT_FLOAT:
+				tokens.set_payload(i, literals.add_float(from.literals.floating(tokens.literal(i))));
+				break;
+			case (int)TokenType::LIT_CHAR:
+				tokens.set_payload(i, literals.add_char(from.literals.character(tokens.literal(i))));
+				break;
+			case (int)TokenType::LIT_STRING:
+			{
+				// Strings that are their source text still point into it, the rest were decoded
+				std::string_view str = from.literals.string(tokens.literal(i));
+				bool in_source = str.data() >= text.data() && str.data() < text.data() + text.size();
+				tokens.set_payload(i, in_source ? literals.add_string(str) : literals.copy_string(str));
+				break;
+			}
+			case (int)TokenType::ID:
+			case (int)TokenType::LF:
+			{
+				auto [it, added] = from.kept.try_emplace(tokens.symbol(i));
+				if (added)
+					it->second = Session::symbols.intern(from.symbols.name(tokens.symbol(i)));
+				tokens.set_payload(i, it->second);
+				break;
+			}
+		}
+	}
+}
+
+TokenBuffer ParallelLexer::tokenize_all() {
+	std::string_view text = translation_unit.source();
+	size_t count = std::min(threads, text.size() / MIN_CHUNK_SIZE);
+
+	// Streams aren't all there yet, so they can't be split up
+	if (count < 2 || translation_unit.is_streaming())
+		return Lexer(translation_unit, handler).tokenize_all();
+
+	// Split the text at the first line start after every even share
+	std::vector<Chunk> chunks;
+	chunks.reserve(count);
+	size_t start = 0;
+	for (size_t i = 1; i < count; i++) {
+		size_t at = text.size() / count * i;
+		size_t end = at + scan::find_byte(text.substr(at), '\n') + 1;
+		if (end <= start || end >= text.size())
+			continue;
+
+		chunks.emplace_back(translation_unit, start, end);
+		start = end;
+	}
+	chunks.emplace_back(translation_unit, start, text.size());
+
+	// The first chunk is read on this thread
+	std::vector<std::thread> pool;
+	pool.reserve(chunks.size() - 1);
+	for (size_t i = 1; i < chunks.size(); i++)
+		pool.emplace_back([this, &chunks, i]() { lex_chunk(chunks[i]); });
+	lex_chunk(chunks[0]);
+	for (auto& t : pool)
+		t.join();
+
+	TokenBuffer tokens(translation_unit);
+	tokens.reserve(text.size() / 4 + 1);
+	Staging own;
+	std::vector<Origin> origins;
+	if (stitch(chunks, tokens, own, origins)) {
+		commit(tokens, origins);
+		return tokens;
+	}
+
+	// Let a single Lexer report the diagnostics in order
+	return Lexer(translation_unit, handler).tokenize_all();
+}
\ No newline at end of file
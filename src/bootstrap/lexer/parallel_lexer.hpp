@@ -0,0 +1,88 @@
+#pragma once
+#include "lexer.hpp"
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+/* Lexes a single large Translation Unit on several threads.
+ * The text is split into chunks at line starts, and every chunk is lexed on its own
+ * thread as if a new token started there. That's wrong for a chunk that starts inside
+ * a block comment or a string literal, so the chunks are stitched together by lexing
+ * on from the end of the previous chunk until a token ends where one of the chunk's
+ * tokens ends. The Lexer only depends on where it starts reading, so from there on
+ * the chunk's tokens are the same ones a single Lexer would have read.
+ * Literals and names are only decoded and interned for the Translation Unit once the tokens
+ * are stitched together, in order, so tokens that are thrown away leave nothing behind.
+ * The result is always the same as that of 'Lexer::tokenize_all()', down to the literal ids and symbols. */
+class ParallelLexer {
+
+private:
+	/* Where a Lexer decodes literals and interns names while its tokens might still be thrown away. */
+	struct Staging {
+		LiteralPool literals;
+		Interner symbols;
+		/* The Session's symbols for the names that have been kept. */
+		std::unordered_map<Symbol, Symbol> kept;
+	};
+
+	/* The tokens from 'first' on were read with the given Staging, up to the next Origin. */
+	struct Origin {
+		size_t first;
+		Staging* staging;
+	};
+
+	/* A part of the text and the tokens that were read from it. */
+	struct Chunk {
+		/* Where lexing started. */
+		size_t start;
+		/* Tokens that start at or after this belong to the next chunk. */
+		size_t end;
+		/* The tokens read from the chunk. */
+		TokenBuffer tokens;
+		/* False if lexing stopped early because of a diagnostic. */
+		bool complete = false;
+		/* The literals and names of the tokens. */
+		std::unique_ptr<Staging> staging = std::make_unique<Staging>();
+
+		Chunk(const TranslationUnit& tu, size_t start, size_t end) : start(start), end(end), tokens(tu) {}
+
+		/* If the chunk's lexer was at 'pos' at some point,
+		 * returns the index of the first token it read from there. */
+		std::optional<size_t> token_from(size_t pos) const;
+	};
+
+	/* The file that is being read */
+	TranslationUnit& translation_unit;
+	/* Reports diagnostics, which are only ever made by a single Lexer. */
+	ErrorHandler& handler;
+	/* The most threads to use. */
+	size_t threads;
+
+	/* Reads the tokens of a chunk.
+	 * Stops at the first diagnostic, which might not be real if the chunk started in the wrong place. */
+	void lex_chunk(Chunk& chunk);
+
+	/* Joins the tokens of every chunk into one buffer, lexing wherever the chunks were wrong.
+	 * The tokens read here use 'own' as their Staging. Where each token came from is added to 'origins'.
+	 * Returns false if a diagnostic came up. */
+	bool stitch(const std::vector<Chunk>& chunks, TokenBuffer& tokens, Staging& own, std::vector<Origin>& origins);
+
+	/* Decodes the literals and interns the names of the stitched tokens
+	 * into the Translation Unit and the Session, in order. */
+	void commit(TokenBuffer& tokens, const std::vector<Origin>& origins);
+
+public:
+	/* The smallest amount of text worth giving its own thread. */
+	static constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+	/* Construct a lexer that uses up to 'threads' threads on the provided Translation Unit. */
+	ParallelLexer(TranslationUnit& tu, ErrorHandler& handler, size_t threads)
+		: translation_unit(tu), handler(handler), threads(threads) {}
+
+	/* Reads every token of the Translation Unit.
+	 * Small files and streams are read by a single Lexer.
+	 * If there are any diagnostics, the file is read again by a single Lexer,
+	 * so they are reported exactly like they would be without threads. */
+	TokenBuffer tokenize_all();
+};
\ No newline at end of file
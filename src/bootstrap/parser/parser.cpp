@@ -2,13 +2,14 @@
 #include "util/ranges.hpp"
 #include "util/token_info.hpp"
 #include <algorithm>
+#include <array>
 
 #define DEFAULT_PARSE_END(x) { end_trace(); return x; }
 
 /* Contains recovery point presets */
 namespace recover {
 
-	static const Recovery decl_start = {
+	constexpr Recovery decl_start = {
 		(int)TokenType::IMPORT,
 		(int)TokenType::EXPORT,
 		(int)TokenType::USE,
@@ -32,7 +33,7 @@ namespace recover {
 		(int)TokenType::MUT,
 	};
 
-	static const Recovery stmt_start = {
+	constexpr Recovery stmt_start = {
 		(int)TokenType::VAR,
 		(int)TokenType::FUN,
 
@@ -52,7 +53,7 @@ namespace recover {
 		(int)TokenType::MUT,
 	};
 
-	static const Recovery type_start = {
+	constexpr Recovery type_start = {
 		'*',
 		'&',
 		'[',
@@ -77,7 +78,7 @@ namespace recover {
 		(int)TokenType::F64
 	};
 
-	static const Recovery expr_end = {
+	constexpr Recovery expr_end = {
 		',',
 		'.',
 		';',
@@ -87,16 +88,19 @@ namespace recover {
 		'}'
 	};
 
-	static const Recovery semi = { ';' };
+	constexpr Recovery semi = { ';' };
 }
 
-/* Info about a binary operator. */
+/* Info about a binary operator.
+ * Operators bind tighter the higher their precedence.
+ * A precedence of 0 means the token isn't a binary operator. */
 struct OPInfo {
-	int prec;
+	int prec = 0;
 	enum {
 		LEFT,
 		RIGHT
-	} assoc;
+	} assoc = LEFT;
+	ast::NodeType node = ast::NodeType::ExprAssign;
 };
 
 
@@ -104,48 +108,54 @@ struct OPInfo {
 /////////////////////////////////      Operators / OPInfo      ////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-/* A single operator-opinfo pair.
- * Key - operator (char)
- * Value - OPInfo. */
-struct OPInfoPair {
-	const int key;
-	OPInfo value;
-};
-/* Maps operators to their OPInfo. */
-constexpr static OPInfoPair opinfo_map[] {
-	{'=',    {1, OPInfo::RIGHT}},
-	{(int)TokenType::SUME,  {1, OPInfo::RIGHT}},
-	{(int)TokenType::SUBE,  {1, OPInfo::RIGHT}},
-	{(int)TokenType::MULE,  {1, OPInfo::RIGHT}},
-	{(int)TokenType::SUBE,  {1, OPInfo::RIGHT}},
-	{(int)TokenType::MODE,  {1, OPInfo::RIGHT}},
-	{(int)TokenType::CARE,  {1, OPInfo::RIGHT}},
-
-	{(int)TokenType::OR,    {2, OPInfo::LEFT}},	// ||
-	{(int)TokenType::AND,   {3, OPInfo::LEFT}},	// &&
-
-	{(int)TokenType::EQEQ,  {4, OPInfo::LEFT}},	// ==
-	{(int)TokenType::NE,    {4, OPInfo::LEFT}},	// !=
-	{(int)TokenType::LE,    {5, OPInfo::LEFT}},	// >=
-	{(int)TokenType::GE,    {5, OPInfo::LEFT}},	// <=
-
-	{'<',    {5, OPInfo::LEFT}},
-	{'>',    {5, OPInfo::LEFT}},
-
-	{'+',    {6, OPInfo::LEFT}},
-	{'-',    {6, OPInfo::LEFT}},
-	{'*',    {7, OPInfo::LEFT}},
-	{'/',    {7, OPInfo::LEFT}},
-	{'%',    {7, OPInfo::LEFT}},
-	{'^',    {8, OPInfo::RIGHT}},
-};
-/* Attempts to find the given operator in the OPInfo map.
- * If no operations match, a nullptr is returned. */
-constexpr const OPInfoPair* op_find(int key) {
-	for (unsigned long i = 0; i < sizeof(opinfo_map)/sizeof(*opinfo_map); i++)
-		if (opinfo_map[i].key == key)
-			return &opinfo_map[i];
-	return nullptr;
+/* Builds the table of binary operators, indexed by token type. */
+constexpr std::array<OPInfo, TOKEN_TYPES> make_opinfo_table() {
+	std::array<OPInfo, TOKEN_TYPES> table = {};
+	auto set = [&](int key, int prec, decltype(OPInfo::assoc) assoc, ast::NodeType node) {
+		table[key].prec = prec;
+		table[key].assoc = assoc;
+		table[key].node = node;
+	};
+
+	set('=',                     1, OPInfo::RIGHT, ast::NodeType::ExprAssign);
+	set((int)TokenType::SUME,    1, OPInfo::RIGHT, ast::NodeType::ExprSumEq);	// +=
+	set((int)TokenType::SUBE,    1, OPInfo::RIGHT, ast::NodeType::ExprSubEq);	// -=
+	set((int)TokenType::MULE,    1, OPInfo::RIGHT, ast::NodeType::ExprMulEq);	// *=
+	set((int)TokenType::DIVE,    1, OPInfo::RIGHT, ast::NodeType::ExprDivEq);	// /=
+	set((int)TokenType::MODE,    1, OPInfo::RIGHT, ast::NodeType::ExprModEq);	// %=
+	set((int)TokenType::CARE,    1, OPInfo::RIGHT, ast::NodeType::ExprExpEq);	// ^=
+	set((int)TokenType::ORE,     1, OPInfo::RIGHT, ast::NodeType::ExprBitOrEq);	// |=
+	set((int)TokenType::ANDE,    1, OPInfo::RIGHT, ast::NodeType::ExprBitAndEq);	// &=
+
+	set((int)TokenType::OR,      2, OPInfo::LEFT, ast::NodeType::ExprOr);		// ||
+	set((int)TokenType::AND,     3, OPInfo::LEFT, ast::NodeType::ExprAnd);		// &&
+
+	set((int)TokenType::EQEQ,    4, OPInfo::LEFT, ast::NodeType::ExprEq);		// ==
+	set((int)TokenType::NE,      4, OPInfo::LEFT, ast::NodeType::ExprNotEq);	// !=
+	set((int)TokenType::LE,      5, OPInfo::LEFT, ast::NodeType::ExprLesserEq);	// <=
+	set((int)TokenType::GE,      5, OPInfo::LEFT, ast::NodeType::ExprGreaterEq);	// >=
+	set('<',                     5, OPInfo::LEFT, ast::NodeType::ExprLesser);
+	set('>',                     5, OPInfo::LEFT, ast::NodeType::ExprGreater);
+
+	set((int)TokenType::SHL,     6, OPInfo::LEFT, ast::NodeType::ExprShl);		// <<
+	set((int)TokenType::SHR,     6, OPInfo::LEFT, ast::NodeType::ExprShr);		// >>
+
+	set('+',                     7, OPInfo::LEFT, ast::NodeType::ExprSum);
+	set('-',                     7, OPInfo::LEFT, ast::NodeType::ExprSub);
+	set('*',                     8, OPInfo::LEFT, ast::NodeType::ExprMul);
+	set('/',                     8, OPInfo::LEFT, ast::NodeType::ExprDiv);
+	set('%',                     8, OPInfo::LEFT, ast::NodeType::ExprMod);
+	set('^',                     9, OPInfo::RIGHT, ast::NodeType::ExprExp);
+	return table;
+}
+
+/* Maps token types to their OPInfo. */
+constexpr static std::array<OPInfo, TOKEN_TYPES> opinfo_table = make_opinfo_table();
+
+/* The OPInfo of a token.
+ * Tokens that aren't binary operators have a precedence of 0. */
+inline const OPInfo& op_find(const Token& tk) {
+	return opinfo_table[tk.type()];
 }
 
 
@@ -155,11 +165,11 @@ constexpr const OPInfoPair* op_find(int key) {
 
 /* Concatenate a low span and hi span into a new span. */
 inline Span concat_span(const Span& start, const Span& end) {
-	return Span(*start.tu, start.lo_bit, end.hi_bit);
+	return Span(start.lo_bit, end.hi_bit);
 }
 /* Concatenate a low pos and hi span into a new span. */
-inline Span concat_span(size_t lo, const Span& hi_sp) {
-	return Span(*hi_sp.tu, lo, hi_sp.hi_bit);
+inline Span concat_span(uint32_t lo, const Span& hi_sp) {
+	return Span(lo, hi_sp.hi_bit);
 }
 
 /* True if the provided token is a primitive. */
@@ -208,27 +218,7 @@ inline bool is_attr(const Token& tk) {
 
 /* True is the provided token is a binary operator. */
 inline bool is_binop(const Token& tk) {
-	return tk == TokenType::AND ||
-		tk == TokenType::OR ||
-		tk == TokenType::EQEQ ||
-		tk == TokenType::NE ||
-		tk == TokenType::LE ||
-		tk == TokenType::GE ||
-		tk == TokenType::SUME ||
-		tk == TokenType::SUBE ||
-		tk == TokenType::MULE ||
-		tk == TokenType::DIVE ||
-		tk == TokenType::MODE ||
-		tk == TokenType::CARE ||
-		tk.type() == '=' ||
-		tk.type() == '<' ||
-		tk.type() == '>' ||
-		tk.type() == '+' ||
-		tk.type() == '-' ||
-		tk.type() == '*' ||
-		tk.type() == '/' ||
-		tk.type() == '%' ||
-		tk.type() == '^';
+	return op_find(tk).prec > 0;
 }
 
 /* True is the provided token is a unary operator. */
@@ -236,6 +226,93 @@ inline bool is_unaryop(const Token& tk) {
 	return tk.type() == '-' || tk.type() == '!' || tk.type() == '&' || tk.type() == '*';
 }
 
+Token Parser::pop_streamed() {
+	// The Lexer only stops early when it runs into a fatal error,
+	// which it has already reported
+	auto tk = stream->pop();
+	if (!tk)
+		throw FatalException();
+	return *tk;
+}
+
+const Token& Parser::streamed(size_t& index) {
+	while (window_start + window.size() <= index) {
+		// Nothing comes after the 'END' token
+		if (!window.empty() && window.back() == TokenType::END) {
+			index = window_start + window.size() - 1;
+			break;
+		}
+		window.push_back(pop_streamed());
+	}
+	return window[index - window_start];
+}
+
+void Parser::bump_streamed(int n) {
+	tok_index += n;
+	curr_tok = streamed(tok_index);
+
+	// Drop the tokens that are too old to rewind to, once there's a good amount of them
+	if (tok_index - window_start > 2 * REWIND_LIMIT) {
+		size_t drop = tok_index - window_start - REWIND_LIMIT;
+		window.erase(window.begin(), window.begin() + drop);
+		window_start += drop;
+	}
+}
+
+void Parser::rewind(const Checkpoint& cp) {
+	if (stream && cp.index < window_start)
+		bug("rewound further back than the streamed tokens are kept");
+	tok_index = cp.index;
+	curr_tok = cp.tok;
+}
+
+bool Parser::struct_init_follows() {
+	Token first = peek(1);
+	int after = peek(2).type();
+
+	// Empty braces are a struct literal if the expression goes on after them,
+	// otherwise they're an empty block, like in 'while x {}'
+	if (first.type() == '}')
+		return after == ';' || after == ',' || after == ')' || after == ']' || after == '.';
+
+	return first == TokenType::ID && (after == ':' || after == ',' || after == '}');
+}
+
+bool Parser::generic_args_follow() {
+	// The current '<' is already open
+	int depth = 1;
+
+	for (size_t k = 1; k < LOOKAHEAD_LIMIT; k++) {
+		Token tk = peek(k);
+		switch (tk.type()) {
+			case '<': depth++; break;
+			case '>': depth--; break;
+			case (int)TokenType::SHR: depth -= 2; break;
+
+			// Anything that can be part of a type or lifetime
+			case ',': case '&': case '*': case '[': case ']': case '(': case ')': case ';': case '_':
+			case (int)TokenType::ID:
+			case (int)TokenType::SCOPE:
+			case (int)TokenType::LF:
+			case (int)TokenType::LIT_INTEGER:
+				break;
+
+			default:
+				if (!is_primitive(tk))
+					return false;
+		}
+
+		// A '>>' that closes more than is open is a shift
+		if (depth < 0)
+			return false;
+		if (depth == 0) {
+			int next = peek(k + 1).type();
+			return next == '(' || next == '{' || next == (int)TokenType::SCOPE;
+		}
+	}
+	return false;
+}
+
 /* Splits the current multi-character binop into smaller tokens. */
 Token Parser::split_multi_binop() {
 	switch (curr_tok.type()) {
@@ -258,11 +335,11 @@ Token Parser::split_multi_binop() {
 			curr_tok = Token(
 				curr_tok.raw()[1],
 				curr_tok.raw().substr(1, 2),
-				Span(*curr_tok.span().tu, curr_tok.span().lo_bit + 1, curr_tok.span().lo_bit + 2));
+				Span(curr_tok.span().lo_bit + 1, curr_tok.span().lo_bit + 2));
 			return Token(
 				curr_tok.raw()[0],
 				curr_tok.raw().substr(0, 1),
-				Span(*curr_tok.span().tu, curr_tok.span().lo_bit, curr_tok.span().lo_bit + 1));
+				Span(curr_tok.span().lo_bit, curr_tok.span().lo_bit + 1));
 		default:
 			return curr_tok;
 	}
@@ -278,58 +355,44 @@ void Parser::recover_to(const Recovery& to) {
 		{
 		case '(':
 			if (paren_lvl++ == 0) {
-				for (auto c : to) {
-					if (c == '(')
-						return;
-				}
+				if (to.contains('('))
+					return;
 			}
 			break;
 		case ')':
 			if (paren_lvl-- == 0) {
-				for (auto c : to) {
-					if (c == '}')
-						return;
-				}
+				if (to.contains(')'))
+					return;
 			}
 			break;
 		case '[':
 			if (brack_lvl++ == 0) {
-				for (auto c : to) {
-					if (c == '[')
-						return;
-				}
+				if (to.contains('['))
+					return;
 			}
 			break;
 		case ']':
 			if (brack_lvl-- == 0) {
-				for (auto c : to) {
-					if (c == ']')
-						return;
-				}
+				if (to.contains(']'))
+					return;
 			}
 			break;
 		case '{':
 			if (brace_lvl++ == 0) {
-				for (auto c : to) {
-					if (c == '{')
-						return;
-				}
+				if (to.contains('{'))
+					return;
 			}
 			break;
 		case '}':
 			if (brace_lvl-- == 0) {
-				for (auto c : to) {
-					if (c == '}')
-						return;
-				}
+				if (to.contains('}'))
+					return;
 			}
 			break;
 		default:
 			if (paren_lvl <= 0 || brack_lvl <= 0 || brace_lvl <= 0) {
-				for (auto c : to) {
-					if (curr_tok.type() == c)
-						return;
-				}
+				if (to.contains(curr_tok.type()))
+					return;
 			}
 			break;
 		}
@@ -337,16 +400,6 @@ void Parser::recover_to(const Recovery& to) {
 	}
 }
 
-inline Recovery operator+(Recovery first, const Recovery& second) {
-	first.reserve(first.size() + second.size());
-	first.insert(
-		std::end(first),
-		std::begin(second),
-		std::end(second)
-	);
-	return first;
-}
-
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////    Expects    ///////////////////////////////////////////
@@ -362,13 +415,12 @@ inline Error* Parser::expect_symbol(char sym) {
 		return nullptr;
 	}
 	else {
-		Token backup = curr_tok;
+		// The rest of a split token becomes the current one
+		auto cp = checkpoint();
 		auto tk = split_multi_binop();
-		if (tk.type() == (int)sym) {
-			bump();
+		if (tk.type() == (int)sym)
 			return nullptr;
-		}
-		curr_tok = backup;
+		rewind(cp);
 	}
 	std::string found = curr_tok.type() < 256 ?
 		std::string{'\'', (char)curr_tok.type(), '\'' } :	// TRUE
@@ -388,11 +440,11 @@ inline Error* Parser::expect_keyword(TokenType ty) {
 		return nullptr;
 	}
 	else {
+		auto cp = checkpoint();
 		auto tk = split_multi_binop();
-		if (tk == ty) {
-			bump();
+		if (tk == ty)
 			return nullptr;
-		}
+		rewind(cp);
 	}
 	return err_expected(translate::tk_type(curr_tok), "the keyword '" + translate::tk_type(ty) + "'");
 }
@@ -470,67 +522,67 @@ ast::TypePrimitive* Parser::primitive() {
 
 	switch (curr_tok.type()) {
 		case (int)TokenType::THING:
-			ret = new ast::TypeThing(sp);
+			ret = make<ast::TypeThing>(sp);
 			bump();
 			break;
 		case (int)TokenType::STR:
-			ret = new ast::TypeStr(sp);
+			ret = make<ast::TypeStr>(sp);
 			bump();
 			break;
 		case (int)TokenType::CHAR:
-			ret = new ast::TypeChar(sp);
+			ret = make<ast::TypeChar>(sp);
 			bump();
 			break;
 		case (int)TokenType::INT:
-			ret = new ast::TypeISize(sp);
+			ret = make<ast::TypeISize>(sp);
 			bump();
 			break;
 		case (int)TokenType::I8:
-			ret = new ast::TypeI8(sp);
+			ret = make<ast::TypeI8>(sp);
 			bump();
 			break;
 		case (int)TokenType::I16:
-			ret = new ast::TypeI16(sp);
+			ret = make<ast::TypeI16>(sp);
 			bump();
 			break;
 		case (int)TokenType::I32:
-			ret = new ast::TypeI32(sp);
+			ret = make<ast::TypeI32>(sp);
 			bump();
 			break;
 		case (int)TokenType::I64:
-			ret = new ast::TypeI64(sp);
+			ret = make<ast::TypeI64>(sp);
 			bump();
 			break;
 		case (int)TokenType::UINT:
-			ret = new ast::TypeUSize(sp);
+			ret = make<ast::TypeUSize>(sp);
 			bump();
 			break;
 		case (int)TokenType::U8:
-			ret = new ast::TypeU8(sp);
+			ret = make<ast::TypeU8>(sp);
 			bump();
 			break;
 		case (int)TokenType::U16:
-			ret = new ast::TypeU16(sp);
+			ret = make<ast::TypeU16>(sp);
 			bump();
 			break;
 		case (int)TokenType::U32:
-			ret = new ast::TypeU32(sp);
+			ret = make<ast::TypeU32>(sp);
 			bump();
 			break;
 		case (int)TokenType::U64:
-			ret = new ast::TypeU64(sp);
+			ret = make<ast::TypeU64>(sp);
 			bump();
 			break;
 		case (int)TokenType::FLOAT:
-			ret = new ast::TypeFSize(sp);
+			ret = make<ast::TypeFSize>(sp);
 			bump();
 			break;
 		case (int)TokenType::F32:
-			ret = new ast::TypeF32(sp);
+			ret = make<ast::TypeF32>(sp);
 			bump();
 			break;
 		case (int)TokenType::F64:
-			ret = new ast::TypeF64(sp);
+			ret = make<ast::TypeF64>(sp);
 			bump();
 			break;
 		default: {
@@ -550,7 +602,7 @@ ast::Ident* Parser::ident() {
 	ast::Ident* id = nullptr;
 	if (curr_tok == TokenType::ID) {
 		auto sp = Span(curr_tok.span());
-		id = new ast::Ident(curr_tok.raw(), sp);
+		id = make<ast::Ident>(curr_tok.symbol(), sp);
 		bump();
 	}
 	else err_expected(translate::tk_type(curr_tok), "an identifier");
@@ -571,7 +623,7 @@ ast::Lifetime* Parser::lifetime() {
 	ast::Lifetime* lf = nullptr;
 	if (is_lifetime(curr_tok)) {
 		auto sp = Span(curr_tok.span());
-		lf = new ast::Lifetime(curr_tok.raw(), sp);
+		lf = make<ast::Lifetime>(curr_tok.symbol(), sp);
 		bump();
 	}
 	else err_expected(translate::tk_type(curr_tok), "a lifetime");
@@ -598,40 +650,37 @@ inline ast::Value* Parser::literal() {
 	switch (curr_tok.type()) {
 		case (int)TokenType::LIT_TRUE: {
 			auto sp = Span(curr_tok.span());
-			val = new ast::ValueBool(true, sp);
+			val = make<ast::ValueBool>(true, sp);
 			bump();
 			break;
 		}
 		case (int)TokenType::LIT_FALSE: {
 			auto sp = Span(curr_tok.span());
-			val = new ast::ValueBool(false, sp);
+			val = make<ast::ValueBool>(false, sp);
 			bump();
 			break;
 		}
 		case (int)TokenType::LIT_STRING: {
 			auto sp = Span(curr_tok.span());
-			val = new ast::ValueString(curr_tok.raw(), sp);
+			val = make<ast::ValueString>(literals(), curr_tok.literal(), sp);
 			bump();
 			break;
 		}
-		case (int)TokenType::LIT_CHAR: { // TODO:  This will have problems with character values larger than 256
+		case (int)TokenType::LIT_CHAR: {
 			auto sp = Span(curr_tok.span());
-			auto str = std::string(curr_tok.raw());
-			val = new ast::ValueChar(curr_tok.raw()[0], sp); /// <--
+			val = make<ast::ValueChar>(literals().character(curr_tok.literal()), sp);
 			bump();
 			break;
 		}
 		case (int)TokenType::LIT_INTEGER: {
 			auto sp = Span(curr_tok.span());
-			auto str = std::string(curr_tok.raw());
-			val = new ast::ValueInt(atoi(str.c_str()), sp);
+			val = make<ast::ValueInt>(literals(), curr_tok.literal(), sp);
 			bump();
 			break;
 		}
 		case (int)TokenType::LIT_FLOAT: {
 			auto sp = Span(curr_tok.span());
-			auto str = std::string(curr_tok.raw());
-			val = new ast::ValueFloat(atof(str.c_str()), sp);
+			val = make<ast::ValueFloat>(literals(), curr_tok.literal(), sp);
 			bump();
 			break;
 		}
@@ -688,23 +737,23 @@ inline Attributes Parser::attributes() {
 //      | ident ('.' ident)*
 ast::Path* Parser::path(int delim, const Recovery& to) {
 	trace("path");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 	Path path;
 
 	// Add current token to path
 	auto id_ret = ident(to + Recovery{(int)TokenType::SCOPE});
-	path.push_back(std::unique_ptr<ast::Ident>(id_ret));
+	path.push_back(ast::Box<ast::Ident>(id_ret));
 
 	while (curr_tok.type() == delim) {
 		bump();
 
 		// Add current token to path
 		auto id_ret = ident(to + Recovery{delim});
-		path.push_back(std::unique_ptr<ast::Ident>(id_ret));
+		path.push_back(ast::Box<ast::Ident>(id_ret));
 	}
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto decl = new ast::Path(path, sp);
+	auto decl = make<ast::Path>(path, sp);
 	DEFAULT_PARSE_END(decl)
 }
 
@@ -721,7 +770,7 @@ GenericParamVec Parser::generic_params(const Recovery& recovery) {
 	if (curr_tok.type() != '>') {
 
 		auto param_ret = generic_param(recovery + Recovery{',', '>'});
-		generics.push_back(std::unique_ptr<ast::GenericParam>(std::get<1>(param_ret)));
+		generics.push_back(ast::Box<ast::GenericParam>(std::get<1>(param_ret)));
 
 		while (curr_tok.type() == ',') {
 			bump();
@@ -730,7 +779,7 @@ GenericParamVec Parser::generic_params(const Recovery& recovery) {
 				break;
 
 			param_ret = generic_param(recovery + Recovery{',', '>'});
-			generics.push_back(std::unique_ptr<ast::GenericParam>(std::get<1>(param_ret)));
+			generics.push_back(ast::Box<ast::GenericParam>(std::get<1>(param_ret)));
 			if (std::get<0>(param_ret)) {
 				if (curr_tok.type() != ',' && curr_tok.type() != '>') {
 					break;
@@ -772,14 +821,14 @@ ParamVec Parser::param_list(bool is_method, const Recovery& recovery) {
 		}
 		else {
 			auto param_ret = param(recovery + Recovery{',', ')'});
-			params.push_back(std::unique_ptr<ast::Param>(std::get<1>(param_ret)));
+			params.push_back(ast::Box<ast::Param>(std::get<1>(param_ret)));
 		}
 
 		while (curr_tok.type() == ',') {
 			bump();
 
 			auto param_ret = param(recovery + Recovery{',', ')'});
-			params.push_back(std::unique_ptr<ast::Param>(std::get<1>(param_ret)));
+			params.push_back(ast::Box<ast::Param>(std::get<1>(param_ret)));
 
 			if (curr_tok.type() == ')' || curr_tok.type() != ',')
 				break;
@@ -794,7 +843,7 @@ ParamVec Parser::param_list(bool is_method, const Recovery& recovery) {
 // param : ident ':' type
 std::tuple<Error*, ast::Param*> Parser::param(const Recovery& recovery) {
 	trace("param");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 	Error* err = nullptr;
 
 	auto id_ret = ident(recovery + Recovery{':'});
@@ -809,7 +858,7 @@ std::tuple<Error*, ast::Param*> Parser::param(const Recovery& recovery) {
 	if (!err && std::get<0>(ty_ret)) { err = std::get<0>(ty_ret); }
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto param = new ast::Param(id_ret, std::get<1>(ty_ret), sp);
+	auto param = make<ast::Param>(id_ret, std::get<1>(ty_ret), sp);
 	DEFAULT_PARSE_END(std::tuple(err, param));
 }
 
@@ -848,14 +897,14 @@ ExprVec Parser::arg_list(const Recovery& recovery) {
 
 		auto arg_ret = arg(recovery + Recovery{',', ')'});
 		if (!std::get<0>(arg_ret))
-			exprs.push_back(std::unique_ptr<ast::Expr>(std::get<1>(arg_ret)));
+			exprs.push_back(ast::Box<ast::Expr>(std::get<1>(arg_ret)));
 
 		while (curr_tok.type() == ',') {
 			bump();
 
 			auto arg_ret = arg(recovery + Recovery{',', ')'});
 			if (!std::get<0>(arg_ret))
-				exprs.push_back(std::unique_ptr<ast::Expr>(std::get<1>(arg_ret)));
+				exprs.push_back(ast::Box<ast::Expr>(std::get<1>(arg_ret)));
 
 			if (curr_tok.type() == ')')
 				break;
@@ -883,7 +932,7 @@ std::tuple<Error*, ast::Type*> Parser::return_type(const Recovery& recovery) {
 	}
 	else {
 		auto sp = Span(curr_tok.span());
-		ret = std::tuple(nullptr, new ast::TypeVoid(sp));
+		ret = std::tuple(nullptr, make<ast::TypeVoid>(sp));
 	}
 	DEFAULT_PARSE_END(ret);
 }
@@ -897,7 +946,9 @@ std::tuple<Error*, ast::Type*> Parser::return_type(const Recovery& recovery) {
 std::shared_ptr<ASTRoot> Parser::parse() {
 	trace("parse");
 
-	auto ast = std::make_shared<ASTRoot>(&lexer.trans_unit());
+	auto ast = std::make_shared<ASTRoot>(&tokens.trans_unit());
+	// Every node of the tree is placed in its arena
+	Arena::Use arena(ast->arena);
 
 	// As long as the end of the file has not been reached,
 	// expect to find decls
@@ -905,6 +956,9 @@ std::shared_ptr<ASTRoot> Parser::parse() {
 		ast->add_decl(decl(true));
 	}
 
+	// Streamed sources only know their size once they've been read
+	ast->span.hi_bit = tokens.trans_unit().end_pos();
+
 	DEFAULT_PARSE_END(ast);
 }
 
@@ -982,7 +1036,7 @@ ast::Decl* Parser::decl(bool is_global) {
 //             | MOD path ';'               // if global
 ast::DeclModule* Parser::decl_module(bool is_global) {
 	trace("decl_module");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_keyword(TokenType::MOD))
 		bug("decl_sub_module not checked before invoking");
@@ -992,7 +1046,7 @@ ast::DeclModule* Parser::decl_module(bool is_global) {
 
 	auto mod_path = path((int)TokenType::SCOPE, recover::decl_start + rec);
 
-	std::vector<std::unique_ptr<ast::Decl>> decls;	
+	DeclVec decls;	
 	if (curr_tok.type() == ';') {
 		// Handle non-global file modules
 		// Make an error
@@ -1007,7 +1061,7 @@ ast::DeclModule* Parser::decl_module(bool is_global) {
 			bump();
 			trace("module_block");
 			while (curr_tok != TokenType::END)
-				decls.push_back(std::unique_ptr<ast::Decl>(decl(false)));
+				decls.push_back(ast::Box<ast::Decl>(decl(false)));
 			end_trace();
 		}
 	}
@@ -1017,12 +1071,12 @@ ast::DeclModule* Parser::decl_module(bool is_global) {
 
 	// Get the modules span
 	auto sp = concat_span(start, curr_tok.span());
-	auto decl = new ast::DeclModule(mod_path, decls, sp);
+	auto decl = make<ast::DeclModule>(mod_path, decls, sp);
 	DEFAULT_PARSE_END(decl);
 }
 
 // module_block : '{' decl* '}'
-std::vector<std::unique_ptr<ast::Decl>> Parser::module_block() {
+DeclVec Parser::module_block() {
 	trace("module_block");
 
 	if (expect_symbol('{'))
@@ -1030,7 +1084,7 @@ std::vector<std::unique_ptr<ast::Decl>> Parser::module_block() {
 
 	// Keep collection declarations until a bracket is found
 	// Fail if the file abruptly ends 
-	std::vector<std::unique_ptr<ast::Decl>> decls;
+	DeclVec decls;
 	while (curr_tok.type() != '}') {
 		if (curr_tok == TokenType::END) {
 			// Fail if the file ends inside the module block
@@ -1038,7 +1092,7 @@ std::vector<std::unique_ptr<ast::Decl>> Parser::module_block() {
 			return decls;
 		}
 		// Save declarations
-		decls.push_back(std::unique_ptr<ast::Decl>(decl(false)));
+		decls.push_back(ast::Box<ast::Decl>(decl(false)));
 	}
 	expect_sym_recheck('}', recover::decl_start);
 
@@ -1049,7 +1103,7 @@ std::vector<std::unique_ptr<ast::Decl>> Parser::module_block() {
 //                  | IMPORT PACKAGE path ';'
 ast::Decl* Parser::decl_import_item() {
 	trace("decl_import_item");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_keyword(TokenType::IMPORT))
 		bug("decl_import_item not checked before invoking");
@@ -1080,8 +1134,8 @@ ast::Decl* Parser::decl_import_item() {
 
 	auto sp = concat_span(start, curr_tok.span());
 	auto decl = (import_ty == MOD) ?
-		(ast::Decl*) new ast::DeclModuleImport(import_path, sp) :
-		(ast::Decl*) new ast::DeclPackageImport(import_path, sp);
+		(ast::Decl*) make<ast::DeclModuleImport>(import_path, sp) :
+		(ast::Decl*) make<ast::DeclPackageImport>(import_path, sp);
 
 	DEFAULT_PARSE_END(decl);
 }
@@ -1089,7 +1143,7 @@ ast::Decl* Parser::decl_import_item() {
 // decl_var : VAR ident (':' type_with_lf)? ('=' expr)? ';'
 ast::DeclVar* Parser::decl_var(bool is_const, bool is_static) {
 	trace("decl_var");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_keyword(TokenType::VAR))
 		bug("decl_var not checked before invoking");
@@ -1133,7 +1187,7 @@ ast::DeclVar* Parser::decl_var(bool is_const, bool is_static) {
 	expect_sym_recheck(';', recover::decl_start);
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto decl = new ast::DeclVar(id_ret, lifetime, type, value, sp);
+	auto decl = make<ast::DeclVar>(id_ret, lifetime, type, value, sp);
 	DEFAULT_PARSE_END(decl);
 }
 
@@ -1141,7 +1195,7 @@ ast::DeclVar* Parser::decl_var(bool is_const, bool is_static) {
 //           | TYPE ident '=' type ';'
 ast::DeclType* Parser::decl_type() {
 	trace("decl_type");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_keyword(TokenType::TYPE))
 		bug("decl_type not checked before invoking");
@@ -1159,14 +1213,14 @@ ast::DeclType* Parser::decl_type() {
 	expect_sym_recheck(';', recover::decl_start);
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto decl = new ast::DeclType(id_ret, ty, sp);
+	auto decl = make<ast::DeclType>(id_ret, ty, sp);
 	DEFAULT_PARSE_END(decl);
 }
 
 // decl_use : USE path ';'
 ast::DeclUse* Parser::decl_use() {
 	trace("decl_use");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_keyword(TokenType::USE))
 		bug("decl_use not checked before invoking");
@@ -1176,7 +1230,7 @@ ast::DeclUse* Parser::decl_use() {
 	expect_sym_recheck(';', recover::decl_start);
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto decl = new ast::DeclUse(path, sp);
+	auto decl = make<ast::DeclUse>(path, sp);
 	DEFAULT_PARSE_END(decl);
 }
 
@@ -1184,7 +1238,7 @@ ast::DeclUse* Parser::decl_use() {
 //          | FUN ident generic_params? param_list (RARROW return_type)? fun_block
 ast::DeclFun* Parser::decl_fun(bool is_method) {
 	trace("decl_fun");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_keyword(TokenType::FUN))
 		bug("decl_fun not checked before invoking");
@@ -1216,22 +1270,23 @@ ast::DeclFun* Parser::decl_fun(bool is_method) {
 	else block = fun_block();
 	
 	auto sp = concat_span(start, curr_tok.span());
-	auto decl = new ast::DeclFun(id_ret, generics, params, std::get<1>(ret_type), block, sp);
+	auto decl = make<ast::DeclFun>(id_ret, generics, params, std::get<1>(ret_type), block, sp);
 	DEFAULT_PARSE_END(decl);
 }
 
 // fun_block : '{' stmt* '}'
 FunBlock Parser::fun_block() {
 	trace("fun_block");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_symbol('{'))
 		bug("fun_block not checked before invoking");
 
 	// Collect statements 
+	// A missing '}' is reported once the file runs out
 	StmtVec stmts;
-	while (curr_tok.type() != '}') {
-		stmts.push_back(std::unique_ptr<ast::Stmt>(stmt({'}'})));
+	while (curr_tok.type() != '}' && curr_tok != TokenType::END) {
+		stmts.push_back(ast::Box<ast::Stmt>(stmt({'}'})));
 	}
 	expect_sym_recheck('}', recover::decl_start);
 
@@ -1695,7 +1750,7 @@ ast::Stmt* Parser::stmt(const Recovery& recovery) {
 			break;
 
 		default: {
-				size_t start = curr_tok.span().lo_bit;
+				uint32_t start = curr_tok.span().lo_bit;
 
 				// Attempt to parse an expression, since no other statements match
 				auto expr_ret = expr(1);
@@ -1888,7 +1943,7 @@ void Parser::stmt_case(const Recovery& recovery) {
 // stmt_return : RETURN expr? ';'
 ast::StmtReturn* Parser::stmt_return(const Recovery& recovery) {
 	trace("stmt_return");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_keyword(TokenType::RETURN)) {
 		expect_sym_recheck(';', recovery);
@@ -1904,14 +1959,14 @@ ast::StmtReturn* Parser::stmt_return(const Recovery& recovery) {
 	expect_sym_recheck(';', recovery);
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto ret = new ast::StmtReturn(ex, sp);
+	auto ret = make<ast::StmtReturn>(ex, sp);
 	DEFAULT_PARSE_END(ret)
 }
 
 // stmt_break : BREAK ';'
 ast::StmtBreak* Parser::stmt_break(const Recovery& recovery) {
 	trace("stmt_break");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_keyword(TokenType::BREAK)) {
 		expect_sym_recheck(';', recovery);
@@ -1921,14 +1976,14 @@ ast::StmtBreak* Parser::stmt_break(const Recovery& recovery) {
 	expect_sym_recheck(';', recovery);
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto ret = new ast::StmtBreak(sp);
+	auto ret = make<ast::StmtBreak>(sp);
 	DEFAULT_PARSE_END(ret);
 }
 
 // stmt_continue : CONTINUE ';'
 ast::StmtContinue* Parser::stmt_continue(const Recovery& recovery) {
 	trace("stmt_continue");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_keyword(TokenType::CONTINUE)) {
 		expect_sym_recheck(';', recovery);
@@ -1938,7 +1993,7 @@ ast::StmtContinue* Parser::stmt_continue(const Recovery& recovery) {
 	expect_sym_recheck(';', recovery);
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto ret = new ast::StmtContinue(sp);
+	auto ret = make<ast::StmtContinue>(sp);
 	DEFAULT_PARSE_END(ret);
 }
 
@@ -1952,127 +2007,71 @@ ast::StmtContinue* Parser::stmt_continue(const Recovery& recovery) {
 // expr : val (binop expr)*
 std::tuple<Error*, ast::Expr*> Parser::expr(int min_prec) {
 	trace("expr");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
-	ast::Expr* lhs = nullptr;
-	ast::Expr* rhs = nullptr;
 	Error* err = nullptr;
 
-	auto val_ret = val(Recovery{'+', '-', '*', '/', '^'}); // FIXME:  HORRIBLE STUFF EXPRESSION PRECEDENCE IS DEAD
+	// Stop at the next operator, so the rest of the expression can still be parsed,
+	// but never skip past the end of the expression
+	auto val_ret = val(recover::expr_end + Recovery{'+', '-', '*', '/', '^'});
 	err = std::get<0>(val_ret);
-	lhs = std::get<1>(val_ret);
+	ast::Expr* lhs = std::get<1>(val_ret);
 
-	// This while loop should only loop through once
-	// We only want it for the 'break' statement
+	// Operators of the same precedence are folded into 'lhs' one after the other,
+	// so only tighter binding and right associative operators recurse
 	while (is_binop(curr_tok)) {
 
-		auto opinfo = op_find(curr_tok.type());
-		if (!opinfo)
-			bug("inconsistent binary operator definitions; missing " + translate::tk_info(curr_tok));
-
-		if (opinfo->value.prec < min_prec)
+		const OPInfo& opinfo = op_find(curr_tok);
+		if (opinfo.prec < min_prec)
 			break;
 
+		int op = curr_tok.type();
 		trace("binop: " + std::string(curr_tok.raw()));
 		end_trace();
 
 		bump();
 
 		// Decide next expression's operator precedence requirements
-		int next_prec = opinfo->value.assoc == OPInfo::LEFT ? opinfo->value.prec + 1 : opinfo->value.prec;
-
-		if (opinfo->key == '.') {
-			auto id = ident(recover::expr_end);
-			auto sp = concat_span(start, curr_tok.span());
-
-			auto ex = new ast::ExprMemAcc(lhs, id, sp);
-
-			auto ret = std::tuple(err, ex);
-			DEFAULT_PARSE_END(ret);
-		}
+		int next_prec = opinfo.assoc == OPInfo::LEFT ? opinfo.prec + 1 : opinfo.prec;
 
 		auto expr_ret = expr(next_prec);
-		rhs = std::get<1>(expr_ret);
+		ast::Expr* rhs = std::get<1>(expr_ret);
 		if (!err) { err = std::get<0>(expr_ret); }
 
 		auto sp = concat_span(start, curr_tok.span());
 
-		ast::Expr* ex = nullptr;
-		switch(opinfo->key)
+		switch (opinfo.node)
 		{
-		case (int)TokenType::AND:
-			ex = new ast::ExprAnd(lhs, rhs, sp);
-			break;
-		case (int)TokenType::OR:
-			ex = new ast::ExprOr(lhs, rhs, sp);
-			break;
-		case (int)TokenType::EQEQ:
-			ex = new ast::ExprEq(lhs, rhs, sp);
-			break;
-		case (int)TokenType::NE:
-			ex = new ast::ExprNotEq(lhs, rhs, sp);
-			break;
-		case (int)TokenType::LE:
-			ex = new ast::ExprLesserEq(lhs, rhs, sp);
-			break;
-		case (int)TokenType::GE:
-			ex = new ast::ExprGreaterEq(lhs, rhs, sp);
-			break;
-		case (int)TokenType::SUME:
-			ex = new ast::ExprSumEq(lhs, rhs, sp);
-			break;
-		case (int)TokenType::SUBE:
-			ex = new ast::ExprSubEq(lhs, rhs, sp);
-			break;
-		case (int)TokenType::MULE:
-			ex = new ast::ExprMulEq(lhs, rhs, sp);
-			break;
-		case (int)TokenType::DIVE:
-			ex = new ast::ExprDivEq(lhs, rhs, sp);
-			break;
-		case (int)TokenType::MODE:
-			ex = new ast::ExprModEq(lhs, rhs, sp);
-			break;
-		case (int)TokenType::CARE:
-			unimpl("^= expressions");
-			break;
-		case '=':
-			ex = new ast::ExprAssign(lhs, rhs, sp);
-			break;
-		case '<':
-			ex = new ast::ExprLesser(lhs, rhs, sp);
-			break;
-		case '>':
-			ex = new ast::ExprGreater(lhs, rhs, sp);
-			break;
-		case '+':
-			ex = new ast::ExprSum(lhs, rhs, sp);
-			break;
-		case '-':
-			ex = new ast::ExprSub(lhs, rhs, sp);
-			break;
-		case '*':
-			ex = new ast::ExprMul(lhs, rhs, sp);
-			break;
-		case '/':
-			ex = new ast::ExprDiv(lhs, rhs, sp);
-			break;
-		case '%':
-			ex = new ast::ExprMod(lhs, rhs, sp);
-			break;
-		case '^':
-			ex = new ast::ExprExp(lhs, rhs, sp);
-			break;
+		case ast::NodeType::ExprAssign:		lhs = make<ast::ExprAssign>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprSumEq:		lhs = make<ast::ExprSumEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprSubEq:		lhs = make<ast::ExprSubEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprMulEq:		lhs = make<ast::ExprMulEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprDivEq:		lhs = make<ast::ExprDivEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprModEq:		lhs = make<ast::ExprModEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprExpEq:		lhs = make<ast::ExprExpEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprBitOrEq:	lhs = make<ast::ExprBitOrEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprBitAndEq:	lhs = make<ast::ExprBitAndEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprOr:			lhs = make<ast::ExprOr>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprAnd:		lhs = make<ast::ExprAnd>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprEq:			lhs = make<ast::ExprEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprNotEq:		lhs = make<ast::ExprNotEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprLesserEq:	lhs = make<ast::ExprLesserEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprGreaterEq:	lhs = make<ast::ExprGreaterEq>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprLesser:		lhs = make<ast::ExprLesser>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprGreater:	lhs = make<ast::ExprGreater>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprShl:		lhs = make<ast::ExprShl>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprShr:		lhs = make<ast::ExprShr>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprSum:		lhs = make<ast::ExprSum>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprSub:		lhs = make<ast::ExprSub>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprMul:		lhs = make<ast::ExprMul>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprDiv:		lhs = make<ast::ExprDiv>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprMod:		lhs = make<ast::ExprMod>(lhs, rhs, sp); break;
+		case ast::NodeType::ExprExp:		lhs = make<ast::ExprExp>(lhs, rhs, sp); break;
 		default:
-			bug("inconsistent binary operator definitions; missing " + translate::tk_info(opinfo->key));
+			bug("inconsistent binary operator definitions; missing " + translate::tk_info(op));
 		}
-
-		// Return a binop expression node
-		auto ret = std::tuple(err, ex);
-		DEFAULT_PARSE_END(ret);
 	}
-		
-	// Return only the value node
+
 	auto ret = std::tuple(err, lhs);
 	DEFAULT_PARSE_END(ret);
 }
@@ -2095,7 +2094,7 @@ std::tuple<Error*, ast::Expr*> Parser::expr(int min_prec, const Recovery& recove
 //      | '(' ')'
 std::tuple<Error*, ast::Value*> Parser::val(const Recovery& recovery) {
 	trace("val");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	std::tuple<Error*, ast::Value*> ret;
 
@@ -2111,6 +2110,19 @@ std::tuple<Error*, ast::Value*> Parser::val(const Recovery& recovery) {
 	else if (curr_tok == TokenType::ID) {			// path
 		auto val_path = path((int)TokenType::SCOPE, recovery);
 
+		// FIXME:  keep the generic arguments once values can have them
+		while (curr_tok.type() == '<' && generic_args_follow()) {
+			generic_params(recovery);
+
+			// The path can go on after them, like in 'Vec<T>::new'
+			while (curr_tok == TokenType::SCOPE) {
+				bump();
+				auto id_ret = ident(recovery + Recovery{(int)TokenType::SCOPE});
+				val_path->sub_paths.push_back(ast::Box<ast::Ident>(id_ret));
+			}
+			val_path->span = concat_span(start, curr_tok.span());
+		}
+
 		ast::Value* val = nullptr;
 		switch(curr_tok.type()) {
 			case '!': {
@@ -2118,7 +2130,7 @@ std::tuple<Error*, ast::Value*> Parser::val(const Recovery& recovery) {
 				auto args = arg_list(recovery);
 
 				auto sp = concat_span(start, curr_tok.span());
-				val = new ast::ValueMacroInvoc(val_path, args, sp);
+				val = make<ast::ValueMacroInvoc>(val_path, args, sp);
 				break;
 			}
 
@@ -2126,32 +2138,38 @@ std::tuple<Error*, ast::Value*> Parser::val(const Recovery& recovery) {
 				auto args = arg_list(recovery);
 
 				auto sp = concat_span(start, curr_tok.span());
-				val = new ast::ValueFunCall(val_path, args, sp);
+				val = make<ast::ValueFunCall>(val_path, args, sp);
 				break;
 			}
 			case '[': {
 				auto items = arr_init(recovery);
 
 				auto sp = concat_span(start, curr_tok.span());
-				val = new ast::ValueArray(items, sp);
+				val = make<ast::ValueArray>(items, sp);
 				break;
 			}
 			case '{': {
+				// Could also be a block after the value, like in 'if x { .. }'
+				if (!struct_init_follows()) {
+					auto sp = concat_span(start, curr_tok.span());
+					val = make<ast::ValuePath>(val_path, sp);
+					break;
+				}
 				auto fields = struct_init(recovery);
 
 				auto sp = concat_span(start, curr_tok.span());
-				val = new ast::ValueStruct(val_path, fields, sp);
+				val = make<ast::ValueStruct>(val_path, fields, sp);
 				break;
 			}
 
 			default:
 				auto sp = concat_span(start, curr_tok.span());
-				val = new ast::ValuePath(val_path, sp);
+				val = make<ast::ValuePath>(val_path, sp);
 		}
 		ret = std::tuple(nullptr, val);
 	}
 	else if (curr_tok.type() == '(') {				// '('
-		size_t start = curr_tok.span().lo_bit;
+		uint32_t start = curr_tok.span().lo_bit;
 		bump();
 
 		ExprVec exprs;
@@ -2161,7 +2179,7 @@ std::tuple<Error*, ast::Value*> Parser::val(const Recovery& recovery) {
 			auto expr_ret = expr(1);
 			err = std::get<0>(expr_ret);
 			auto expr_1 = std::get<1>(expr_ret);
-			exprs.push_back(std::unique_ptr<ast::Expr>(expr_1));
+			exprs.push_back(ast::Box<ast::Expr>(expr_1));
 
 			while (curr_tok.type() == ',') {		// '(' expr (',' expr)* ')'
 				bump();
@@ -2169,17 +2187,17 @@ std::tuple<Error*, ast::Value*> Parser::val(const Recovery& recovery) {
 				auto expr_ret = expr(1);
 				if (!err) { err = std::get<0>(expr_ret); }
 				auto expr_1 = std::get<1>(expr_ret);
-				exprs.push_back(std::unique_ptr<ast::Expr>(expr_1));
+				exprs.push_back(ast::Box<ast::Expr>(expr_1));
 			}
 		}
 		expect_sym_recheck(')', recovery);
 
 		auto sp = concat_span(start, curr_tok.span());
-		auto decl = new ast::ValueTuple(exprs, sp);
+		auto decl = make<ast::ValueTuple>(exprs, sp);
 		ret = std::tuple(err, decl);
 	}
 	else if (curr_tok.type() == '[') {
-		size_t start = curr_tok.span().lo_bit;
+		uint32_t start = curr_tok.span().lo_bit;
 		bump();
 
 		ExprVec exprs;
@@ -2189,7 +2207,7 @@ std::tuple<Error*, ast::Value*> Parser::val(const Recovery& recovery) {
 			auto expr_ret = expr(1);
 			err = std::get<0>(expr_ret);
 			auto expr_1 = std::get<1>(expr_ret);
-			exprs.push_back(std::unique_ptr<ast::Expr>(expr_1));
+			exprs.push_back(ast::Box<ast::Expr>(expr_1));
 
 			while (curr_tok.type() == ',') {		// '[' expr (',' expr)* ']'
 				bump();
@@ -2197,13 +2215,13 @@ std::tuple<Error*, ast::Value*> Parser::val(const Recovery& recovery) {
 				auto expr_ret = expr(1);
 				if (!err) { err = std::get<0>(expr_ret); }
 				auto expr_1 = std::get<1>(expr_ret);
-				exprs.push_back(std::unique_ptr<ast::Expr>(expr_1));
+				exprs.push_back(ast::Box<ast::Expr>(expr_1));
 			}
 		}
 		expect_sym_recheck(']', recovery);
 
 		auto sp = concat_span(start, curr_tok.span());
-		auto decl = new ast::ValueArray(exprs, sp);
+		auto decl = make<ast::ValueArray>(exprs, sp);
 		ret = std::tuple(err, decl);
 	}
 	else if (is_literal(curr_tok)) {				// literal
@@ -2234,7 +2252,7 @@ std::tuple<Error*, ast::Value*> Parser::val(const Recovery& recovery) {
 				auto args = arg_list(recovery);
 
 				auto sp = concat_span(start, curr_tok.span());
-				val = new ast::ValueMacroInvoc(val_path, args, sp);
+				val = make<ast::ValueMacroInvoc>(val_path, args, sp);
 				break;
 			}
 
@@ -2242,27 +2260,33 @@ std::tuple<Error*, ast::Value*> Parser::val(const Recovery& recovery) {
 				auto args = arg_list(recovery);
 
 				auto sp = concat_span(start, curr_tok.span());
-				val = new ast::ValueFunCall(val_path, args, sp);
+				val = make<ast::ValueFunCall>(val_path, args, sp);
 				break;
 			}
 			case '[': {
 				auto items = arr_init(recovery);
 
 				auto sp = concat_span(start, curr_tok.span());
-				val = new ast::ValueArray(items, sp);
+				val = make<ast::ValueArray>(items, sp);
 				break;
 			}
 			case '{': {
+				// Could also be a block after the value, like in 'if x { .. }'
+				if (!struct_init_follows()) {
+					auto sp = concat_span(start, curr_tok.span());
+					val = make<ast::ValuePath>(val_path, sp);
+					break;
+				}
 				auto fields = struct_init(recovery);
 
 				auto sp = concat_span(start, curr_tok.span());
-				val = new ast::ValueStruct(val_path, fields, sp);
+				val = make<ast::ValueStruct>(val_path, fields, sp);
 				break;
 			}
 
 			default:
 				auto sp = concat_span(start, curr_tok.span());
-				val = new ast::ValuePath(val_path, sp);
+				val = make<ast::ValuePath>(val_path, sp);
 			}
 			ret = std::tuple(nullptr, val);
 		}
@@ -2282,25 +2306,25 @@ ast::UnaryOp* Parser::unary_op() {
 	switch (curr_tok.type()) {
 		case '-': {
 			auto sp = Span(curr_tok.span());
-			uop = new ast::UopNeg(sp);
+			uop = make<ast::UopNeg>(sp);
 			bump();
 			break;
 		}
 		case '!': {
 			auto sp = Span(curr_tok.span());
-			uop = new ast::UopNot(sp);
+			uop = make<ast::UopNot>(sp);
 			bump();
 			break;
 		}
 		case '&': {
 			auto sp = Span(curr_tok.span());
-			uop = new ast::UopAddr(sp);
+			uop = make<ast::UopAddr>(sp);
 			bump();
 			break;
 		}
 		case '*': {
 			auto sp = Span(curr_tok.span());
-			uop = new ast::UopDeref(sp);
+			uop = make<ast::UopDeref>(sp);
 			bump();
 			break;
 		}
@@ -2386,7 +2410,7 @@ ExprVec Parser::arr_init(const Recovery& recovery) {
 		
 		auto field_ret = arr_field();
 		if (std::get<0>(field_ret))
-			fields.push_back(std::unique_ptr<ast::Expr>(std::get<1>(field_ret)));
+			fields.push_back(ast::Box<ast::Expr>(std::get<1>(field_ret)));
 
 		else {
 			while (curr_tok.type() == ',') {
@@ -2397,7 +2421,7 @@ ExprVec Parser::arr_init(const Recovery& recovery) {
 
 				auto field_ret = arr_field();
 				if (std::get<0>(field_ret))
-					fields.push_back(std::unique_ptr<ast::Expr>(std::get<1>(field_ret)));
+					fields.push_back(ast::Box<ast::Expr>(std::get<1>(field_ret)));
 			}
 		}
 	}
@@ -2476,7 +2500,7 @@ std::tuple<Error*, ast::Type*> Parser::type(const Recovery& recovery) {
 
 std::tuple<Error*, ast::TypeRef*> Parser::type_ref(const Recovery& recovery) {
 	trace("type_ref");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_symbol('&'))
 		bug("type_ptr not checked before invoking");
@@ -2490,7 +2514,7 @@ std::tuple<Error*, ast::TypeRef*> Parser::type_ref(const Recovery& recovery) {
 	auto ty_ret = type(recovery);
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto ty = new ast::TypeRef(std::get<1>(ty_ret), mut, sp);
+	auto ty = make<ast::TypeRef>(std::get<1>(ty_ret), mut, sp);
 
 	auto ret = std::tuple(std::get<0>(ty_ret), ty);
 	DEFAULT_PARSE_END(ret);
@@ -2498,7 +2522,7 @@ std::tuple<Error*, ast::TypeRef*> Parser::type_ref(const Recovery& recovery) {
 
 std::tuple<Error*, ast::TypePtr*> Parser::type_ptr(const Recovery& recovery) {
 	trace("type_ptr");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_symbol('*'))
 		bug("type_ptr not checked before invoking");
@@ -2512,7 +2536,7 @@ std::tuple<Error*, ast::TypePtr*> Parser::type_ptr(const Recovery& recovery) {
 	auto ty_ret = type(recovery);
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto ty = new ast::TypePtr(std::get<1>(ty_ret), mut, sp);
+	auto ty = make<ast::TypePtr>(std::get<1>(ty_ret), mut, sp);
 
 	auto ret = std::tuple(std::get<0>(ty_ret), ty);
 	DEFAULT_PARSE_END(ret)
@@ -2523,7 +2547,7 @@ std::tuple<Error*, ast::TypePtr*> Parser::type_ptr(const Recovery& recovery) {
 //            | '(' type (',' type)* ')'    // TypeTuple
 std::tuple<Error*, ast::Type*> Parser::type_tuple(const Recovery& recovery) {
 	trace("type_tuple");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	std::tuple<Error*, ast::Type*> ret;
 
@@ -2534,7 +2558,7 @@ std::tuple<Error*, ast::Type*> Parser::type_tuple(const Recovery& recovery) {
 		bump();	
 
 		auto sp = concat_span(start, curr_tok.span());
-		auto ty = new ast::TypeVoid(sp);
+		auto ty = make<ast::TypeVoid>(sp);
 
 		ret = std::tuple(nullptr, ty);			
 	}
@@ -2543,7 +2567,7 @@ std::tuple<Error*, ast::Type*> Parser::type_tuple(const Recovery& recovery) {
 		Error* err = std::get<0>(ty_ret);
 
 		TypeVec types;
-		types.push_back(std::unique_ptr<ast::Type>(std::get<1>(ty_ret)));
+		types.push_back(ast::Box<ast::Type>(std::get<1>(ty_ret)));
 
 		while(curr_tok.type() != ')') {
 			
@@ -2553,13 +2577,13 @@ std::tuple<Error*, ast::Type*> Parser::type_tuple(const Recovery& recovery) {
 
 			auto ty_ret = type(recovery + Recovery{',', ')'});
 			if (!err) { err = std::get<0>(ty_ret); }
-			types.push_back(std::unique_ptr<ast::Type>(std::get<1>(ty_ret)));
+			types.push_back(ast::Box<ast::Type>(std::get<1>(ty_ret)));
 		}
 
 		expect_sym_recheck(')', recovery);
 
 		auto sp = concat_span(start, curr_tok.span());
-		ast::Type* ty = types.size() == 1 ? types[0].release() : (ast::Type*)new ast::TypeTuple(types, sp);
+		ast::Type* ty = types.size() == 1 ? types[0].release() : (ast::Type*)make<ast::TypeTuple>(types, sp);
 
 		ret = std::tuple(err, ty);
 	}
@@ -2571,7 +2595,7 @@ std::tuple<Error*, ast::Type*> Parser::type_tuple(const Recovery& recovery) {
 //                   | '[' typle ';' expr ']'
 std::tuple<Error*, ast::Type*> Parser::type_arr_or_slice(const Recovery& recovery) {
 	trace("type_arr_or_slice");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	if (expect_symbol('['))
 		bug("type_arr_or_slice not checked before invoking");
@@ -2588,11 +2612,11 @@ std::tuple<Error*, ast::Type*> Parser::type_arr_or_slice(const Recovery& recover
 		if (!err) { err = std::get<0>(expr_ret); }
 
 		auto sp = concat_span(start, curr_tok.span());
-		type = new ast::TypeArray(std::get<1>(ty_ret), std::get<1>(expr_ret), sp);
+		type = make<ast::TypeArray>(std::get<1>(ty_ret), std::get<1>(expr_ret), sp);
 	}
 	else {
 		auto sp = concat_span(start, curr_tok.span());
-		type = new ast::TypeSlice(std::get<1>(ty_ret), sp);
+		type = make<ast::TypeSlice>(std::get<1>(ty_ret), sp);
 	}
 
 	expect_sym_recheck(']', recover::decl_start);
@@ -2604,13 +2628,13 @@ std::tuple<Error*, ast::Type*> Parser::type_arr_or_slice(const Recovery& recover
 // type_path : path
 ast::TypePath* Parser::type_path(const Recovery& recovery) {
 	trace("type_path");
-	size_t start = curr_tok.span().lo_bit;
+	uint32_t start = curr_tok.span().lo_bit;
 
 	auto p = path((int)TokenType::SCOPE, recovery);
 	auto generics = generic_params(recovery);
 
 	auto sp = concat_span(start, curr_tok.span());
-	auto ty = new ast::TypePath(p, generics, sp);
+	auto ty = make<ast::TypePath>(p, generics, sp);
 	DEFAULT_PARSE_END(ty);
 }
 
@@ -2622,7 +2646,7 @@ ast::TypeInfer* Parser::type_infer() {
 	if (expect_symbol('_'))
 		bug("type_infer not checked before invoking");
 
-	auto ty = new ast::TypeInfer(sp);
+	auto ty = make<ast::TypeInfer>(sp);
 	DEFAULT_PARSE_END(ty);
 }
 
@@ -2646,7 +2670,7 @@ std::tuple<Error*, ast::GenericParam*> Parser::type_or_lt(const Recovery& recove
 		if (!lf_ret)
 			err = &handler.last();
 
-		ty_or_lf = new ast::GenericLifetime(lf_ret, lf_ret->span);
+		ty_or_lf = make<ast::GenericLifetime>(lf_ret, lf_ret->span);
 	}
 	else {
 		auto ty_ret = type(recovery);
@@ -2657,7 +2681,7 @@ std::tuple<Error*, ast::GenericParam*> Parser::type_or_lt(const Recovery& recove
 			if (!err) { err = std::get<0>(ty_ret); }
 		}
 
-		ty_or_lf = new ast::GenericType(std::get<1>(ty_ret), std::get<1>(ty_ret)->span);
+		ty_or_lf = make<ast::GenericType>(std::get<1>(ty_ret), std::get<1>(ty_ret)->span);
 	}
 
 	auto ret = std::tuple(err, ty_or_lf);
@@ -2,13 +2,15 @@
 #include "driver/session.hpp"
 #include "source/source_map.hpp"
 #include "lexer/lexer.hpp"
+#include "lexer/parallel_lexer.hpp"
 #include "ast/ast.hpp"
-
-using Recovery = std::vector<int>;
+#include "recovery.hpp"
+#include "util/spsc_ring.hpp"
+#include <algorithm>
 
 /* The workhorse of the compiler's frontend.
  * Responsible for scanning the input grammar.
- * Internally uses a Lexer for text reading and tokenization. */
+ * Internally uses a Lexer to read the whole file into tokens first. */
 class Parser {
 
 private:
@@ -19,11 +21,33 @@ private:
 	 * A complete map of the package being parsed. */
 	SourceMap& source_map;
 
-	/* The parser's internal lexer.
-	 * Used to read text and build tokens from the input file. */
-	Lexer lexer;
-
-	/* The last token provided by the Lexer. */
+	/* Every token of the file being parsed.
+	 * The whole file is lexed up front and the parser walks the tokens by index. */
+	TokenBuffer tokens;
+	/* Index of the current token in the buffer, or in the stream. */
+	size_t tok_index = 0;
+
+	/* Tokens arriving from a Lexer on another thread.
+	 * Only used if the file is lexed while it's parsed, instead of up front. */
+	SpscRing<Token>* stream = nullptr;
+
+	/* Tokens that have been taken from the stream, from index 'window_start' on.
+	 * Holds the tokens that have been peeked at, and enough of the past ones to rewind to. */
+	std::vector<Token> window;
+	size_t window_start = 0;
+
+	/* How many tokens back a checkpoint can still be rewound to while streaming. */
+	static constexpr size_t REWIND_LIMIT = 1 << 10;
+	/* The most tokens looked at ahead to settle an ambiguous construct. */
+	static constexpr size_t LOOKAHEAD_LIMIT = 32;
+
+	/* A position that the parser can go back to. */
+	struct Checkpoint {
+		size_t index;
+		Token tok;
+	};
+
+	/* The current token. */
 	Token curr_tok;
 
 	/* Splits up the current token into smaller tokens
@@ -34,10 +58,52 @@ private:
 	 * The current one becomes the previous one.
 	 * A new token is read as the new one. */
 	inline void bump(int n = 1) {
-		for (int i = 0; i < n; i++)
-			curr_tok = lexer.next_token();
+		if (stream)
+			return bump_streamed(n);
+		tok_index = std::min(tok_index + n, tokens.size() - 1);
+		curr_tok = tokens.token(tok_index);
 	}
 
+	/* Gets the token 'n' places after the current one without moving.
+	 * Past the end of the file, the 'END' token is returned. */
+	inline Token peek(size_t n = 1) {
+		size_t index = tok_index + n;
+		if (stream)
+			return streamed(index);
+		return tokens.token(index);
+	}
+
+	/* Saves the current position, so the parser can go back to it.
+	 * The current token is saved too, in case it has been split up. */
+	inline Checkpoint checkpoint() const { return Checkpoint{ tok_index, curr_tok }; }
+	/* Goes back to a saved position.
+	 * While streaming, it can't be further back than 'REWIND_LIMIT' tokens. */
+	void rewind(const Checkpoint& cp);
+
+	/* Takes the next token from the Lexer's thread, waiting for it if needed. */
+	Token pop_streamed();
+	/* Gets the streamed token at 'index', taking tokens from the stream until it arrives.
+	 * Past the 'END' token, 'index' is moved back onto it. */
+	const Token& streamed(size_t& index);
+	/* Same as 'bump()', while streaming. */
+	void bump_streamed(int n);
+
+	/* Looks ahead to tell a struct literal from a block, expecting the current token to be '{'.
+	 * It's a struct literal if it starts with a field name followed by ':', ',' or '}',
+	 * or if it's empty and the expression goes on after it. */
+	bool struct_init_follows();
+	/* Looks ahead to tell generic arguments from a less-than, expecting the current token to be '<'.
+	 * They're generic arguments if only types follow up to the matching '>',
+	 * which is followed by a call, struct literal or scope. */
+	bool generic_args_follow();
+
+	/* Creates a node in the arena of the tree that's being built. */
+	template<typename T, typename... Args>
+	inline T* make(Args&&... args) { return Arena::current()->make<T>(std::forward<Args>(args)...); }
+
+	/* The decoded values of the literals in the Translation Unit. */
+	inline const LiteralPool& literals() const { return tokens.trans_unit().literals(); }
+
 	/* Requests trace message to be printed.
 	 * Won't be printed if tracing is disabled. */
 	inline void trace(const std::string& msg) const { handler.trace(msg); }
@@ -113,7 +179,7 @@ private:
 	// decl
 	ast::Decl* decl(bool is_global);
 	ast::DeclModule* decl_module(bool is_global);
-	std::vector<std::unique_ptr<ast::Decl>> module_block();
+	DeclVec module_block();
 	ast::Decl* decl_import_item();
 	ast::DeclVar* decl_var(bool is_const, bool is_static);
 	ast::DeclType* decl_type();
@@ -175,9 +241,26 @@ private:
 public:
 	/* Constructs a parser for the file at the provided location. */
 	Parser(SourceMap& src_map, const std::string& filepath)
-		: handler(Session::handler), source_map(src_map), lexer(source_map.load_file(filepath), handler), curr_tok(lexer.next_token())
+		: handler(Session::handler), source_map(src_map), tokens(Lexer(source_map.load_file(filepath), handler).tokenize_all()), curr_tok(tokens.token(0))
 	{}
 
+	/* Constructs a parser for an already loaded Translation Unit.
+	 * All errors are made through the given ErrorHandler,
+	 * so multiple parsers can run at the same time.
+	 * Large files are lexed on up to 'lex_threads' threads. */
+	Parser(ErrorHandler& handler, SourceMap& src_map, TranslationUnit& tu, size_t lex_threads = 1)
+		: handler(handler), source_map(src_map), tokens(ParallelLexer(tu, handler, lex_threads).tokenize_all()), curr_tok(tokens.token(0))
+	{}
+
+	/* Constructs a parser for tokens that are being lexed on another thread.
+	 * The Lexer has to push every token of the Translation Unit, up to and including
+	 * the 'END' token, or close the ring early if it fails. */
+	Parser(ErrorHandler& handler, SourceMap& src_map, TranslationUnit& tu, SpscRing<Token>& stream)
+		: handler(handler), source_map(src_map), tokens(tu), stream(&stream)
+	{
+		curr_tok = streamed(tok_index);
+	}
+
 	/* There shouldn't be any reason to contstruct multiples of the same parser. */
 	Parser(const Parser& other) = delete;
 
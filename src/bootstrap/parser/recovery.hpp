@@ -0,0 +1,36 @@
+#pragma once
+#include "token/token_type.hpp"
+#include <cstdint>
+#include <initializer_list>
+
+/* A set of token types that the parser can recover to after an error.
+ * Stored as a bitset over every token type, so checking a token
+ * and combining sets never allocates. */
+class Recovery {
+
+private:
+	static constexpr int WORDS = (TOKEN_TYPES + 63) / 64;
+
+	uint64_t words[WORDS] = {};
+
+public:
+	constexpr Recovery() = default;
+
+	constexpr Recovery(std::initializer_list<int> types) {
+		for (int ty : types)
+			words[ty / 64] |= (uint64_t)1 << (ty % 64);
+	}
+
+	/* True if the token type is in the set. */
+	constexpr bool contains(int ty) const {
+		return (words[ty / 64] >> (ty % 64)) & 1;
+	}
+
+	/* The token types of both sets. */
+	constexpr Recovery operator+(const Recovery& other) const {
+		Recovery both = *this;
+		for (int i = 0; i < WORDS; i++)
+			both.words[i] |= other.words[i];
+		return both;
+	}
+};
@@ -0,0 +1,64 @@
+#include "literal_pool.hpp"
+
+LiteralPool::Entry& LiteralPool::add(LiteralId& id) {
+	id = count.fetch_add(1, std::memory_order_relaxed);
+	return entries.claim(id);
+}
+
+LiteralId LiteralPool::add_integer(uint64_t value) {
+	LiteralId id;
+	add(id).integer = value;
+	return id;
+}
+
+LiteralId LiteralPool::add_float(double value) {
+	LiteralId id;
+	add(id).floating = value;
+	return id;
+}
+
+LiteralId LiteralPool::add_char(uint32_t value) {
+	LiteralId id;
+	add(id).character = value;
+	return id;
+}
+
+LiteralId LiteralPool::add_text(std::string_view text, bool borrowed) {
+	LiteralId id;
+	Entry& e = add(id);
+	e.text = text.data();
+	e.length = text.size();
+	e.borrowed = borrowed;
+	return id;
+}
+
+LiteralId LiteralPool::add_string(std::string_view text) {
+	if (detached)
+		return copy_string(text);
+	return add_text(text, true);
+}
+
+LiteralId LiteralPool::copy_string(std::string_view text) {
+	std::string_view copy;
+	{
+		std::lock_guard<std::mutex> lock(text_lock);
+		copy = texts.copy(text);
+	}
+	return add_text(copy, false);
+}
+
+void LiteralPool::detach() {
+	if (detached)
+		return;
+	detached = true;
+
+	for (LiteralId id = 0; id < size(); id++) {
+		Entry& e = entries[id];
+		if (!e.borrowed)
+			continue;
+
+		std::string_view copy = texts.copy(std::string_view(e.text, e.length));
+		e.text = copy.data();
+		e.borrowed = false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include "util/arena.hpp"
+#include "util/block_array.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+
+/* Identifies a value in a LiteralPool. */
+using LiteralId = uint32_t;
+
+/* The decoded values of every literal in a Translation Unit.
+ * The Lexer decodes integer, float, character and string literals once,
+ * after which tokens and the AST only refer to them by id.
+ * Values never move once they're added, and they can be added from
+ * several threads at once, like when chunks of a file are lexed in parallel.
+ * An id can be read on another thread once it's been handed over,
+ * like through a ring or by joining the thread that added it. */
+class LiteralPool {
+
+private:
+	/* A single decoded value.
+	 * Which member is set depends on the kind of the literal. */
+	struct Entry {
+		union {
+			uint64_t integer;
+			double floating;
+			uint32_t character;
+			const char* text;
+		};
+		/* Length of the text, for strings. */
+		uint32_t length;
+		/* True if the text is owned by someone else, like the source. */
+		bool borrowed;
+	};
+
+	/* Entries never move, so they can be read while more are added. */
+	BlockArray<Entry> entries;
+	/* The number of ids handed out. */
+	std::atomic<uint32_t> count = 0;
+
+	/* Storage for decoded strings that aren't simply their source text.
+	 * Those are rare enough for a lock. */
+	std::mutex text_lock;
+	Arena texts;
+
+	/* Set once strings can't point into the source anymore. */
+	bool detached = false;
+
+	/* Hands out a new id and returns its entry. */
+	Entry& add(LiteralId& id);
+	/* Adds a string literal, which might be owned by the pool. */
+	LiteralId add_text(std::string_view text, bool borrowed);
+	/* The entry of an id that has been added. */
+	inline const Entry& at(LiteralId id) const { return entries[id]; }
+
+public:
+	LiteralPool() = default;
+
+	LiteralPool(const LiteralPool& other) = delete;
+	LiteralPool& operator=(const LiteralPool& other) = delete;
+
+	/* Adds the value of an integer literal. */
+	LiteralId add_integer(uint64_t value);
+	/* Adds the value of a floating point literal. */
+	LiteralId add_float(double value);
+	/* Adds the code point of a character literal. */
+	LiteralId add_char(uint32_t value);
+	/* Adds a string literal whose text stays alive as long as the pool,
+	 * like a string without escapes, which is the same as in the source.
+	 * The text is copied if the pool has been detached. */
+	LiteralId add_string(std::string_view text);
+	/* Adds a copy of a decoded string literal. */
+	LiteralId copy_string(std::string_view text);
+
+	/* Copies every string that still points into the source,
+	 * and every string that's added from now on, so the source can be changed.
+	 * Can't be called while values are being added. */
+	void detach();
+
+	/* The value of an integer literal. */
+	inline uint64_t integer(LiteralId id) const				{ return at(id).integer; }
+	/* The value of a floating point literal. */
+	inline double floating(LiteralId id) const				{ return at(id).floating; }
+	/* The code point of a character literal. */
+	inline uint32_t character(LiteralId id) const			{ return at(id).character; }
+	/* The decoded text of a string literal. */
+	inline std::string_view string(LiteralId id) const		{ const Entry& e = at(id); return std::string_view(e.text, e.length); }
+
+	/* The number of values in the pool. */
+	inline size_t size() const								{ return count.load(std::memory_order_relaxed); }
+};
\ No newline at end of file
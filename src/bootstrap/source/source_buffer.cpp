@@ -0,0 +1,164 @@
+#include "source_buffer.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__) || defined(__APPLE__)
+	#include <sys/mman.h>
+	#include <cerrno>
+	#include <unistd.h>
+#endif
+
+SourceBuffer::SourceBuffer(std::string_view text) {
+	if (text.empty())
+		return;
+
+	owned = std::make_unique<char[]>(text.size());
+	memcpy(owned.get(), text.data(), text.size());
+	data = owned.get();
+	length = text.size();
+	reserved = text.size();
+}
+
+SourceBuffer SourceBuffer::reserve(size_t capacity) {
+#if defined(__linux__) || defined(__APPLE__)
+	// Ask for less if the address space is limited
+	for (; capacity >= MIN_RESERVE; capacity /= 2) {
+		void* map = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (map != MAP_FAILED) {
+			SourceBuffer buf = SourceBuffer((const char*)map, 0);
+			buf.from_file = false;
+			buf.reserved = capacity;
+			return buf;
+		}
+	}
+	return SourceBuffer();
+#else
+	// Without lazily backed mappings, settle for a smaller heap buffer
+	capacity = std::min(capacity, MIN_RESERVE * 64);
+	SourceBuffer buf = SourceBuffer(std::make_unique<char[]>(capacity), 0);
+	buf.reserved = capacity;
+	return buf;
+#endif
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+	: data(other.data), length(other.length), mapped(other.mapped), from_file(other.from_file), dropped(other.dropped), reserved(other.reserved), owned(std::move(other.owned))
+{
+	// Leave the other buffer empty, so it doesn't unmap our text
+	other.data = "";
+	other.length = 0;
+	other.mapped = false;
+	other.from_file = false;
+	other.dropped = false;
+	other.reserved = 0;
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+	if (this != &other) {
+		release();
+		data = other.data;
+		length = other.length;
+		mapped = other.mapped;
+		from_file = other.from_file;
+		dropped = other.dropped;
+		reserved = other.reserved;
+		owned = std::move(other.owned);
+
+		other.data = "";
+		other.length = 0;
+		other.mapped = false;
+		other.from_file = false;
+		other.dropped = false;
+		other.reserved = 0;
+	}
+	return *this;
+}
+
+bool SourceBuffer::drop() {
+#if defined(__linux__) || defined(__APPLE__)
+	if (!mapped || !from_file || dropped || length == 0)
+		return false;
+
+	// Replace the file's pages with inaccessible space at the same address
+	// Pages that are simply let go would be faulted back in from the file on the next read,
+	// which crashes if the file has been cut short since
+	void* map = mmap(const_cast<char*>(data), reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+	if (map == MAP_FAILED)
+		return false;
+
+	dropped = true;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool SourceBuffer::restore(int fd) {
+#if defined(__linux__) || defined(__APPLE__)
+	if (!dropped)
+		return true;
+
+	char* text = const_cast<char*>(data);
+	if (mprotect(text, length, PROT_READ | PROT_WRITE) != 0)
+		return false;
+	dropped = false;
+
+	size_t done = 0;
+	while (fd >= 0 && done < length) {
+		ssize_t n = pread(fd, text + done, length - done, done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		done += n;
+	}
+
+	// Don't leave half of the text behind
+	if (done < length)
+		memset(text, 0, done);
+
+	mprotect(text, length, PROT_READ);
+	return done == length;
+#else
+	(void)fd;
+	return !dropped;
+#endif
+}
+
+void SourceBuffer::edit(size_t offset, size_t removed, std::string_view inserted) {
+	size_t tail = length - offset - removed;
+	size_t new_len = offset + inserted.size() + tail;
+
+	if (owned && new_len <= reserved) {
+		memmove(owned.get() + offset + inserted.size(), data + offset + removed, tail);
+	}
+	else {
+		// Leave room for the edits that are likely to follow
+		size_t capacity = std::max<size_t>(new_len + new_len / 2, 64);
+		auto buf = std::make_unique<char[]>(capacity);
+		memcpy(buf.get(), data, offset);
+		memcpy(buf.get() + offset + inserted.size(), data + offset + removed, tail);
+
+		release();
+		owned = std::move(buf);
+		data = owned.get();
+		reserved = capacity;
+	}
+
+	memcpy(owned.get() + offset, inserted.data(), inserted.size());
+	length = new_len;
+}
+
+void SourceBuffer::release() {
+#if defined(__linux__) || defined(__APPLE__)
+	if (mapped && reserved > 0)
+		munmap(const_cast<char*>(data), reserved);
+#endif
+	owned.reset();
+	data = "";
+	length = 0;
+	mapped = false;
+	from_file = false;
+	dropped = false;
+	reserved = 0;
+}
\ No newline at end of file
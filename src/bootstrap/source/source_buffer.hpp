@@ -0,0 +1,97 @@
+#pragma once
+#include <memory>
+#include <string_view>
+
+/* Read-only storage for the text of a Translation Unit.
+ * The text is either mapped straight from a file, or it is
+ * owned on the heap if it didn't come from a regular file.
+ * Text that's still arriving, like from a pipe, is appended into
+ * space reserved up front, so it never has to move either.
+ * Moving the buffer doesn't move the text, so views into it
+ * stay valid for as long as the text is alive. */
+class SourceBuffer {
+	friend class FileLoader;
+
+private:
+	/* Start of the text.
+	 * Never null, even for empty buffers. */
+	const char* data = "";
+	/* Length of the text in bytes. */
+	size_t length = 0;
+
+	/* True if 'data' is a memory mapping that has to be unmapped. */
+	bool mapped = false;
+	/* True if the mapping is backed by a file, rather than reserved space. */
+	bool from_file = false;
+	/* True if the text has been dropped and only its space is still reserved. */
+	bool dropped = false;
+	/* Size of the mapping or heap storage.
+	 * Larger than the text if space was reserved for appending. */
+	size_t reserved = 0;
+
+	/* Heap storage, if the text isn't mapped. */
+	std::unique_ptr<char[]> owned;
+
+	/* Takes ownership of an existing memory mapping. */
+	SourceBuffer(const char* map, size_t len) : data(map), length(len), mapped(true), from_file(true), reserved(len) {}
+	/* Takes ownership of a heap buffer. */
+	SourceBuffer(std::unique_ptr<char[]> buf, size_t len) : data(buf.get()), length(len), reserved(len), owned(std::move(buf)) {}
+
+	/* The smallest amount of space worth reserving for appended text. */
+	static constexpr size_t MIN_RESERVE = 1 << 20;
+
+	/* Unmaps or frees the text. */
+	void release();
+
+public:
+	SourceBuffer() = default;
+	/* Copies the given text into a new heap buffer. */
+	explicit SourceBuffer(std::string_view text);
+
+	/* Reserves space for up to 'capacity' bytes of text that will be appended later.
+	 * Less space might be reserved if the system won't give that much.
+	 * The reserved space is only backed by memory once it's written to. */
+	static SourceBuffer reserve(size_t capacity);
+
+	SourceBuffer(SourceBuffer&& other) noexcept;
+	SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+
+	SourceBuffer(const SourceBuffer& other) = delete;
+	SourceBuffer& operator=(const SourceBuffer& other) = delete;
+
+	~SourceBuffer() { release(); }
+
+	/* A view of the entire text. */
+	inline std::string_view view() const	{ return std::string_view(data, length); }
+	/* Length of the text in bytes. */
+	inline size_t size() const				{ return length; }
+	/* True if the text is mapped from a file. */
+	inline bool is_mapped() const			{ return mapped; }
+
+	/* True if the text has been dropped and hasn't been restored yet. */
+	inline bool is_dropped() const			{ return dropped; }
+
+	/* Gives the memory of the text back to the system.
+	 * Only text mapped from a file can be dropped. Its space stays reserved,
+	 * so views into it stay valid once it's restored, but reading it before then is a bug.
+	 * Returns false if the text can't be dropped. */
+	bool drop();
+
+	/* Reads dropped text back into the same place from the start of 'fd'.
+	 * The caller has to check that the file is still as long as the text.
+	 * If it can't be read, or 'fd' is -1, the text is left as zeroes instead.
+	 * Returns false if the text couldn't be read. */
+	bool restore(int fd);
+
+	/* Replaces 'removed' bytes at 'offset' with the 'inserted' text.
+	 * Text that isn't on the heap yet is copied there first, with room to grow,
+	 * so most edits only move the text after them. Views into the text don't stay valid. */
+	void edit(size_t offset, size_t removed, std::string_view inserted);
+
+	/* Reserved space after the end of the text. */
+	inline char* spare()					{ return const_cast<char*>(data) + length; }
+	/* Size of the reserved space after the end of the text. */
+	inline size_t spare_size() const		{ return reserved - length; }
+	/* Adds 'n' bytes that were written to the spare space to the end of the text. */
+	inline void commit(size_t n)			{ length += n; }
+};
\ No newline at end of file
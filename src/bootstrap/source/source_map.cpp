@@ -1,49 +1,570 @@
 #include "source_map.hpp"
+#include "util/hash.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <cerrno>
+#include <cstring>
 #include <memory>
+#include <iostream>
+
+#if defined(__linux__) || defined(__APPLE__)
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+	#include "util/io_ring.hpp"
+	#include <sys/sysmacros.h>
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+
+/* A file in the middle of being read as part of a batch. */
+struct PendingFile {
+	int fd = -1;
+	int error = 0;
+	size_t size = 0;
+	std::optional<FileId> id;
+	/* Only used for files that couldn't be mapped. */
+	std::unique_ptr<char[]> buf;
+	const char* mapping = nullptr;
+#if defined(__linux__)
+	struct statx info;
+#endif
+};
+
+static void open_sync(PendingFile& file, const std::string& path) {
+	file.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file.fd < 0)
+		file.error = errno;
+}
+
+/* Checks what the file is. */
+static void stat_done(PendingFile& file, mode_t mode, size_t size, FileId id) {
+	if (!S_ISREG(mode)) {
+		file.error = S_ISDIR(mode) ? EISDIR : EINVAL;
+		return;
+	}
+
+	file.id = id;
+	file.size = size;
+}
+
+static void stat_sync(PendingFile& file) {
+	struct stat info;
+	if (fstat(file.fd, &info) != 0) {
+		file.error = errno;
+		return;
+	}
+	stat_done(file, info.st_mode, (size_t)info.st_size, FileId{ (uint64_t)info.st_dev, (uint64_t)info.st_ino });
+}
+
+/* Reads the rest of the file, starting at 'done' bytes in.
+ * If the file got shorter since it was checked, only what's there is kept. */
+static void read_sync(PendingFile& file, size_t done) {
+	while (done < file.size) {
+		ssize_t n = pread(file.fd, file.buf.get() + done, file.size - done, done);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			file.error = errno;
+			return;
+		}
+		if (n == 0)
+			break;
+		done += n;
+	}
+	file.size = done;
+}
+
+/* Maps the file, so its text doesn't have to be copied.
+ * If that isn't possible, makes room to read it instead and returns false. */
+static bool map_sync(PendingFile& file) {
+	void* map = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+	if (map == MAP_FAILED) {
+		file.buf = std::make_unique<char[]>(file.size);
+		return false;
+	}
+
+	// The lexer reads the file front to back
+	madvise(map, file.size, MADV_SEQUENTIAL);
+	file.mapping = (const char*)map;
+	return true;
+}
+
+#endif
+
+#if defined(__linux__)
+
+/* Runs one step of a batch through the ring for every file in 'items'.
+ * 'prep' fills in a file's submission, 'done' is given its result.
+ * If the ring fails, the remaining files are given '-EINVAL',
+ * which makes them fall back to doing the step without the ring. */
+template <typename Prep, typename Done>
+static void ring_step(IoRing& ring, const std::vector<size_t>& items, Prep prep, Done done) {
+	size_t next = 0;
+	while (next < items.size()) {
+		unsigned count = 0;
+		io_uring_sqe* sqe;
+		while (next + count < items.size() && (sqe = ring.next_sqe())) {
+			prep(sqe, items[next + count]);
+			sqe->user_data = items[next + count];
+			count++;
+		}
+
+		if (count == 0 || !ring.submit(count)) {
+			for (; next < items.size(); next++)
+				done(items[next], -EINVAL);
+			return;
+		}
+
+		uint64_t file;
+		int res;
+		for (unsigned i = 0; i < count && ring.pop(file, res); i++)
+			done(file, res);
+		next += count;
+	}
+}
+
+/* Reads a batch of files through io_uring.
+ * Every step is submitted for all of the files at once. */
+static void read_batch(IoRing& ring, const std::vector<std::string>& paths, std::vector<PendingFile>& files, size_t lo, size_t hi) {
+	std::vector<size_t> items;
+
+	// Open
+	for (size_t i = lo; i < hi; i++)
+		items.push_back(i);
+
+	ring_step(ring, items,
+		[&](io_uring_sqe* sqe, size_t i) {
+			sqe->opcode = IORING_OP_OPENAT;
+			sqe->fd = AT_FDCWD;
+			sqe->addr = (uint64_t)paths[i].c_str();
+			sqe->open_flags = O_RDONLY | O_CLOEXEC;
+		},
+		[&](size_t i, int res) {
+			if (res >= 0) files[i].fd = res;
+			else if (res == -EINVAL) open_sync(files[i], paths[i]);
+			else files[i].error = -res;
+		});
+
+	// Check the type, size and identity of the files
+	items.clear();
+	for (size_t i = lo; i < hi; i++)
+		if (files[i].fd >= 0)
+			items.push_back(i);
+
+	ring_step(ring, items,
+		[&](io_uring_sqe* sqe, size_t i) {
+			sqe->opcode = IORING_OP_STATX;
+			sqe->fd = files[i].fd;
+			sqe->addr = (uint64_t)"";
+			sqe->len = STATX_TYPE | STATX_SIZE | STATX_INO;
+			sqe->off = (uint64_t)&files[i].info;
+			sqe->statx_flags = AT_EMPTY_PATH;
+		},
+		[&](size_t i, int res) {
+			const struct statx& info = files[i].info;
+			if (res == 0) stat_done(files[i], info.stx_mode, info.stx_size,
+				FileId{ (uint64_t)makedev(info.stx_dev_major, info.stx_dev_minor), info.stx_ino });
+			else if (res == -EINVAL) stat_sync(files[i]);
+			else files[i].error = -res;
+		});
+
+	// Map the files
+	// Mapping can't be done through the ring, but it doesn't touch the text either
+	// Only the files that can't be mapped are read through the ring
+	items.clear();
+	for (size_t i = lo; i < hi; i++)
+		if (files[i].fd >= 0 && files[i].error == 0 && files[i].size > 0 && !map_sync(files[i]))
+			items.push_back(i);
+
+	ring_step(ring, items,
+		[&](io_uring_sqe* sqe, size_t i) {
+			sqe->opcode = IORING_OP_READ;
+			sqe->fd = files[i].fd;
+			sqe->addr = (uint64_t)files[i].buf.get();
+			sqe->len = (uint32_t)std::min<size_t>(files[i].size, 0x7ffff000);
+			sqe->off = 0;
+		},
+		[&](size_t i, int res) {
+			// Short reads are finished without the ring
+			if (res >= 0) read_sync(files[i], (size_t)res);
+			else if (res == -EINVAL) read_sync(files[i], 0);
+			else files[i].error = -res;
+		});
+
+	// Close
+	items.clear();
+	for (size_t i = lo; i < hi; i++)
+		if (files[i].fd >= 0)
+			items.push_back(i);
+
+	ring_step(ring, items,
+		[&](io_uring_sqe* sqe, size_t i) {
+			sqe->opcode = IORING_OP_CLOSE;
+			sqe->fd = files[i].fd;
+		},
+		[&](size_t i, int res) {
+			if (res == -EINVAL) close(files[i].fd);
+			files[i].fd = -1;
+		});
+}
+
+#endif
+
+std::vector<FileRead> FileLoader::read_files(const std::vector<std::string>& paths) {
+	std::vector<FileRead> reads(paths.size());
+
+#if defined(__linux__) || defined(__APPLE__)
+	std::vector<PendingFile> files(paths.size());
+
+	// Keep a limited amount of files open at once
+	constexpr size_t BATCH_SIZE = 256;
+
+#if defined(__linux__)
+	IoRing ring;
+	if (paths.size() > 1 && ring.init((unsigned)std::min(paths.size(), BATCH_SIZE))) {
+		for (size_t lo = 0; lo < paths.size(); lo += BATCH_SIZE)
+			read_batch(ring, paths, files, lo, std::min(lo + BATCH_SIZE, paths.size()));
+	}
+	else
+#endif
+	{
+		// Read the files one by one
+		for (size_t i = 0; i < paths.size(); i++) {
+			PendingFile& file = files[i];
+			open_sync(file, paths[i]);
+			if (file.fd < 0)
+				continue;
+
+			stat_sync(file);
+			if (file.error == 0 && file.size > 0 && !map_sync(file))
+				read_sync(file, 0);
+			close(file.fd);
+			file.fd = -1;
+		}
+	}
+
+	for (size_t i = 0; i < paths.size(); i++) {
+		reads[i].id = files[i].id;
+		reads[i].error = files[i].error;
+		if (files[i].error != 0)
+			continue;
+
+		if (files[i].size == 0)
+			reads[i].text = SourceBuffer();
+		else if (files[i].mapping)
+			reads[i].text = SourceBuffer(files[i].mapping, files[i].size);
+		else
+			reads[i].text = SourceBuffer(std::move(files[i].buf), files[i].size);
+	}
+#else
+	for (size_t i = 0; i < paths.size(); i++) {
+		reads[i].text = read_file(paths[i], &reads[i].id);
+		if (!reads[i].text)
+			reads[i].error = ENOENT;
+	}
+#endif
+
+	return reads;
+}
 
 bool FileLoader::file_exists(const std::string& path) {
 	std::ifstream f (path, std::ios::in | std::ios::binary);
 	return f.good();
 }
 
-std::optional<std::string> FileLoader::read_file(const std::string& path) {
+bool FileLoader::is_stream(const std::string& path) {
+	if (path == "-")
+		return true;
+
+#if defined(__linux__) || defined(__APPLE__)
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 && S_ISFIFO(info.st_mode);
+#else
+	return false;
+#endif
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+
+std::optional<SourceBuffer> FileLoader::read_file(const std::string& path, std::optional<FileId>* id) {
 	// Open the file at the path
-	std::ifstream fs(path);
+	// This is the only time the file is opened
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return std::nullopt;
 
-	// If it opens successfully, read it to a string
-	if (fs.good()) {
-		std::string str;
+	// Only regular files can be mapped
+	struct stat info;
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+		close(fd);
+		return std::nullopt;
+	}
+
+	if (id)
+		*id = FileId{ (uint64_t)info.st_dev, (uint64_t)info.st_ino };
+
+	// Empty files can't be mapped, but they're valid sources
+	size_t len = (size_t)info.st_size;
+	if (len == 0) {
+		close(fd);
+		return SourceBuffer();
+	}
+
+	// Map the file read-only
+	// The mapping keeps the file alive, so the descriptor can be closed right away
+	void* map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return std::nullopt;
+
+	// The lexer reads the file front to back
+	madvise(map, len, MADV_SEQUENTIAL);
 
-		// Initialize string size to file length
+	return SourceBuffer((const char*)map, len);
+}
+
+#else
+
+std::optional<SourceBuffer> FileLoader::read_file(const std::string& path, std::optional<FileId>*) {
+	// Open the file at the path
+	std::ifstream fs(path, std::ios::in | std::ios::binary);
+
+	// If it opens successfully, read it straight into the buffer
+	if (fs.good()) {
+		// Initialize buffer size to file length
 		fs.seekg(0, std::ios::end);
-		str.resize((unsigned int)fs.tellg());
+		size_t len = (size_t)fs.tellg();
 		fs.seekg(0, std::ios::beg);
 
-		// Read to the string
-		fs.read(&str[0], str.size());
+		auto buf = std::make_unique<char[]>(len);
+		fs.read(buf.get(), len);
 
 		fs.close();
-		return str;
+		return SourceBuffer(std::move(buf), len);
 	}
 
 	return std::nullopt;
 }
 
-TranslationUnit& SourceMap::new_translation_unit(const std::string& path, const std::string& src) {
+#endif
+
+TranslationUnit& SourceMap::new_translation_unit(const std::string& path, SourceBuffer&& src) {
+	// The last unit has to stop growing before another one can follow it
+	if (!translation_units.empty() && translation_units.back()->is_streaming())
+		translation_units.back()->fetch_all();
+
+	// Spans only have room for 32-bit positions
+	if (next_start_pos() + src.size() >= UINT32_MAX)
+		handler.emit_fatal("too much source code; the package can't be larger than 4GiB");
+
 	// Create unique_ptr to a new Translation Unit in the file vector
-	translation_units.push_back(std::make_unique<TranslationUnit>(handler, path, src, next_start_pos()));
+	resident_size += src.size();
+	translation_units.push_back(std::make_unique<TranslationUnit>(handler, path, std::move(src), next_start_pos()));
 	// Return the managed pointer
 	return *translation_units.back().get();
 }
 
+TranslationUnit* SourceMap::find_by_content(uint64_t hash, std::string_view text) const {
+	// Equal hashes don't guarantee equal text
+	auto [lo, hi] = by_content.equal_range(hash);
+	for (auto it = lo; it != hi; it++) {
+		if (!it->second->source_intact())
+			continue;
+		std::string_view other = it->second->source();
+		if (other.size() == text.size() && memcmp(other.data(), text.data(), text.size()) == 0)
+			return it->second;
+	}
+	return nullptr;
+}
+
+TranslationUnit& SourceMap::load_source(const std::string& name, std::string_view text) {
+	return new_translation_unit(name, SourceBuffer(text));
+}
+
+void SourceMap::apply_edit(TranslationUnit& tu, const TextEdit& edit) {
+	size_t old_size = tu.source().size();
+	size_t new_size = old_size + edit.shift();
+
+	// Growing past the positions of the unit would run into the next one,
+	// so it moves to the end, where it has room for a while
+	if (tu.start_pos() + new_size > tu.room_end_pos() && &tu != translation_units.back().get()) {
+		if (translation_units.back()->is_streaming())
+			translation_units.back()->fetch_all();
+
+		auto it = std::find_if(translation_units.begin(), translation_units.end(), [&](const auto& other) { return other.get() == &tu; });
+		std::unique_ptr<TranslationUnit> moved = std::move(*it);
+		translation_units.erase(it);
+
+		size_t start = next_start_pos();
+		if (start + 2 * new_size >= UINT32_MAX)
+			handler.emit_fatal("too much source code; the package can't be larger than 4GiB");
+		moved->move_to(start, start + 2 * new_size);
+		translation_units.push_back(std::move(moved));
+	}
+	else if (tu.start_pos() + new_size >= UINT32_MAX) {
+		handler.emit_fatal("too much source code; the package can't be larger than 4GiB");
+	}
+
+	tu.apply_edit(edit);
+	resident_size = resident_size - old_size + new_size;
+}
+
+TranslationUnit* SourceMap::load_stream(const std::string& path) {
+	// The last unit has to stop growing before another one can follow it
+	if (!translation_units.empty() && translation_units.back()->is_streaming())
+		translation_units.back()->fetch_all();
+
+	bool is_stdin = path == "-";
+	std::string name = is_stdin ? "<stdin>" : path;
+
+#if defined(__linux__) || defined(__APPLE__)
+	int fd = is_stdin ? STDIN_FILENO : open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		handler.make_error("failed to open a file at " + path + ": " + strerror(errno));
+		return nullptr;
+	}
+
+	// Spans only have room for 32-bit positions
+	size_t start = next_start_pos();
+	size_t capacity = std::min<size_t>(MAX_STREAM_SIZE, UINT32_MAX - 1 - start);
+
+	SourceBuffer buf = SourceBuffer::reserve(capacity);
+	translation_units.push_back(std::make_unique<TranslationUnit>(handler, name, fd, std::move(buf), start));
+	return translation_units.back().get();
+#else
+	// Without pipes, read the whole stream up front
+	if (!is_stdin)
+		return &load_file(path);
+
+	std::string text = std::string(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+	return &new_translation_unit(name, SourceBuffer(text));
+#endif
+}
+
+void SourceMap::done_with(TranslationUnit& tu) {
+	if (source_budget == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(evict_lock);
+	evict_queue.push_back(&tu);
+
+	// Drop the oldest units first
+	while (resident_size > source_budget && !evict_queue.empty()) {
+		TranslationUnit* old = evict_queue.front();
+		evict_queue.pop_front();
+		if (old->evict())
+			resident_size -= old->source().size();
+	}
+}
+
+const TranslationUnit& SourceMap::trans_unit_at(size_t pos) const {
+	// Find the last Translation Unit that starts at or before the position
+	auto it = std::upper_bound(translation_units.begin(), translation_units.end(), pos,
+		[](size_t pos, const auto& tu) { return pos < tu->start_pos(); });
+
+	if (it == translation_units.begin())
+		handler.make_bug("no translation unit contains position " + std::to_string(pos)).emit();
+	return **(it - 1);
+}
+
+/* Returns the canonical version of the path, or the path itself if there is none. */
+static std::string canonical_path(const std::string& path) {
+	std::error_code ec;
+	std::string canonical = std::filesystem::weakly_canonical(path, ec).string();
+	return ec ? path : canonical;
+}
+
+TranslationUnit& SourceMap::add_file(const std::string& path, const std::string& canonical, std::optional<FileId> id, SourceBuffer&& text) {
+	// The same file reached through a link
+	if (id) {
+		auto same = by_file_id.find(*id);
+		if (same != by_file_id.end())
+			return *(by_path[canonical] = same->second);
+
+		// Another file is its own unit, even if its text is the same
+		TranslationUnit& tu = new_translation_unit(path, std::move(text));
+		by_path[canonical] = &tu;
+		by_file_id[*id] = &tu;
+		return tu;
+	}
+
+	// Without an identity on disk, a copy of an already loaded file is found by its text
+	uint64_t hash = hash::fnv1a(text.view());
+	TranslationUnit* tu = find_by_content(hash, text.view());
+
+	if (!tu) {
+		tu = &new_translation_unit(path, std::move(text));
+		tu->set_content_hash(hash);
+		by_content.emplace(hash, tu);
+	}
+
+	by_path[canonical] = tu;
+	return *tu;
+}
+
 TranslationUnit& SourceMap::load_file(const std::string& path) {
+	// Paths that lead to the same place should be treated the same
+	std::string canonical = canonical_path(path);
+
+	auto found = by_path.find(canonical);
+	if (found != by_path.end())
+		return *found->second;
+
 	// Return text from file, if it opens
-	if (FileLoader::file_exists(path)) {
-		auto file_txt = FileLoader::read_file(path);
-		if (file_txt)
-			return new_translation_unit(path, *file_txt);
-	}
-	
-	handler.emit_fatal("failed to open a file at " + path);
-	throw;
+	std::optional<FileId> id;
+	auto file_txt = FileLoader::read_file(path, &id);
+	if (!file_txt) {
+		handler.emit_fatal("failed to open a file at " + path);
+		throw;
+	}
+
+	return add_file(path, canonical, id, std::move(*file_txt));
+}
+
+std::vector<TranslationUnit*> SourceMap::load_files(const std::vector<std::string>& paths) {
+	std::vector<std::string> canonical;
+	canonical.reserve(paths.size());
+
+	// Only read files that aren't loaded yet, and only once each
+	std::vector<std::string> to_read;
+	std::unordered_map<std::string, size_t> read_index;
+	for (const auto& path : paths) {
+		canonical.push_back(canonical_path(path));
+		if (!by_path.count(canonical.back()) && !read_index.count(canonical.back())) {
+			read_index[canonical.back()] = to_read.size();
+			to_read.push_back(path);
+		}
+	}
+
+	std::vector<FileRead> reads = FileLoader::read_files(to_read);
+
+	// Add the files in the given order, so their positions don't depend on the reads
+	std::vector<TranslationUnit*> units;
+	units.reserve(paths.size());
+	for (size_t i = 0; i < paths.size(); i++) {
+		auto found = by_path.find(canonical[i]);
+		if (found != by_path.end()) {
+			units.push_back(found->second);
+			continue;
+		}
+
+		FileRead& read = reads[read_index[canonical[i]]];
+		if (!read.text) {
+			// Report every failed file once
+			if (read.error != 0)
+				handler.make_error("failed to open a file at " + paths[i] + ": " + strerror(read.error));
+			read.error = 0;
+			units.push_back(nullptr);
+			continue;
+		}
+
+		units.push_back(&add_file(paths[i], canonical[i], read.id, std::move(*read.text)));
+	}
+
+	return units;
 }
\ No newline at end of file
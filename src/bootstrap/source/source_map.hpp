@@ -1,7 +1,37 @@
 #pragma once
 #include "translation_unit.hpp"
 #include <fstream>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace ast {
+	class FlatTree;
+}
+
+/* Identifies a file on disk, no matter which path was used to reach it. */
+struct FileId {
+	uint64_t device = 0;
+	uint64_t inode = 0;
+
+	inline bool operator==(const FileId& other) const { return device == other.device && inode == other.inode; }
+};
+
+struct FileIdHash {
+	inline size_t operator()(const FileId& id) const { return std::hash<uint64_t>()(id.device * 31 + id.inode); }
+};
+
+/* The result of reading one file of a batch. */
+struct FileRead {
+	/* All of the text in the file, if it could be read. */
+	std::optional<SourceBuffer> text;
+	/* The file's identity, where the platform has one. */
+	std::optional<FileId> id;
+	/* The system error code, if the file couldn't be read. */
+	int error = 0;
+};
 
 /* A static class with functions to check if a file exists
  * and to get all of the text in a file. */
@@ -14,10 +44,23 @@ public:
 	/* Returns true if there exists a file at the given path. */
 	static bool file_exists(const std::string& path);
 
-	/* Returns a string with all of the text in the file at the give path
-	 * Throws an exception if the file doesn't exist.
-	 * Checking 'file_exists()' before reading is advised. */
-	static std::optional<std::string> read_file(const std::string& path);
+	/* Returns true if the path is '-', for the standard input, or a named pipe.
+	 * Streams can't be read ahead of time, so they're loaded differently. */
+	static bool is_stream(const std::string& path);
+
+	/* Returns a buffer with all of the text in the file at the given path.
+	 * The file is opened once and mapped read-only, so the text is never copied.
+	 * If the file can't be opened or isn't a regular file, a 'nullopt' is returned.
+	 * If 'id' is given, it's set to the opened file's identity where the platform has one. */
+	static std::optional<SourceBuffer> read_file(const std::string& path, std::optional<FileId>* id = nullptr);
+
+	/* Loads all of the files at the given paths.
+	 * Files are mapped, like with 'read_file', and only read with 'pread' if they can't be.
+	 * On Linux the opens, stats, reads and closes of many files are submitted
+	 * together through io_uring. Everywhere else, or if io_uring isn't
+	 * available, every file is loaded on its own.
+	 * Returns one result per path, in the same order. */
+	static std::vector<FileRead> read_files(const std::vector<std::string>& paths);
 };
 
 /* A map containing all of the source files in a package.
@@ -33,24 +76,105 @@ private:
 	 * Managed by std::unique_ptrs. */
 	std::vector<std::unique_ptr<TranslationUnit>> translation_units;
 
+	/* The parsed tree of every Translation Unit, in the order they were added. */
+	std::vector<std::shared_ptr<ast::FlatTree>> ast_roots;
+
+	/* Indices of already loaded Translation Units.
+	 * Lets a file that's reached multiple times be loaded only once.
+	 * Files are looked up by canonical path, then by their identity on disk.
+	 * Only files without an identity on disk are looked up by the hash of their contents. */
+	std::unordered_map<std::string, TranslationUnit*> by_path;
+	std::unordered_map<FileId, TranslationUnit*, FileIdHash> by_file_id;
+	std::unordered_multimap<uint64_t, TranslationUnit*> by_content;
+
 	/* Creates and returns a new Translation Unit.
 	 * It is automatically added to the SourceMap.
 	 * Does not guard against multiple insertions of the same file. */
-	TranslationUnit& new_translation_unit(const std::string& path, const std::string& src);
+	TranslationUnit& new_translation_unit(const std::string& path, SourceBuffer&& src);
+
+	/* How much source text may stay in memory, in bytes.
+	 * Zero if there's no limit. */
+	size_t source_budget = 0;
+	/* How much source text is in memory, in bytes. */
+	size_t resident_size = 0;
+	/* Translation Units that are done with, oldest first.
+	 * Their text is dropped once the budget is exceeded. */
+	std::deque<TranslationUnit*> evict_queue;
+	/* Guards the budget, units might be done with on any thread. */
+	std::mutex evict_lock;
+
+	/* The most source code a stream can hold. */
+	static constexpr size_t MAX_STREAM_SIZE = 1ull << 30;
+
+	/* Returns an already loaded Translation Unit with the exact same text, if there is one. */
+	TranslationUnit* find_by_content(uint64_t hash, std::string_view text) const;
+
+	/* Adds a file that was just read to the SourceMap and its indices.
+	 * If the same file was already loaded, that Translation Unit is returned instead
+	 * and the new text is dropped. Without an 'id', the same text counts as the same file. */
+	TranslationUnit& add_file(const std::string& path, const std::string& canonical, std::optional<FileId> id, SourceBuffer&& text);
 
 public:
 	SourceMap(ErrorHandler& handler) : handler(handler), translation_units() {}
 
+	/* Load source code that didn't come from a file into the SourceMap.
+	 * The name is used in place of a path. The text is copied. */
+	TranslationUnit& load_source(const std::string& name, std::string_view text);
+
+	/* Edits the text of a Translation Unit in place.
+	 * A unit that outgrows its positions is moved to the end of the SourceMap,
+	 * with room to grow to twice its size, so edits rarely take up new positions.
+	 * The unit can't still be streaming. */
+	void apply_edit(TranslationUnit& tu, const TextEdit& edit);
+
+	/* Load a stream, like the standard input or a named pipe, into the SourceMap.
+	 * Only the start of the stream is waited for. The rest is read as it's lexed,
+	 * so it should be loaded after all of the files, since it can keep growing.
+	 * If the stream can't be opened, an error is reported and a nullptr is returned. */
+	TranslationUnit* load_stream(const std::string& path);
+
 	/* Load a file at a given path into the SourceMap.
 	 * A reference to the new Translation Unit is returned.
-	 * Does not guard against multiple insertions of the same file. */
+	 * If the same file has already been loaded, through any path,
+	 * the existing Translation Unit is returned instead. */
 	TranslationUnit& load_file(const std::string& path);
 
-	/* The next free index in the SourceMap. */
+	/* Load all of the files at the given paths into the SourceMap at once.
+	 * Returns the Translation Unit of every path, in the same order.
+	 * Files that can't be read are reported as errors through the handler
+	 * and their Translation Unit is a nullptr. */
+	std::vector<TranslationUnit*> load_files(const std::vector<std::string>& paths);
+
+	/* Limits how much source text stays in memory.
+	 * Once over the budget, the text of units that are done with is dropped.
+	 * Zero removes the limit. */
+	inline void set_source_budget(size_t bytes) { source_budget = bytes; }
+
+	/* Marks the Translation Unit as fully processed.
+	 * Its text might be dropped from memory to stay within the budget.
+	 * Can be called from any thread. */
+	void done_with(TranslationUnit& tu);
+
+	/* The next free index in the SourceMap.
+	 * Translation Units are one position apart, so that the
+	 * end position of one is never the start of the next.
+	 * Only the last Translation Unit may still be streaming. */
 	inline size_t next_start_pos() const {
-		return translation_units.empty() ? 0 : (*translation_units.end())->end_pos();
+		return translation_units.empty() ? 0 : translation_units.back()->room_end_pos() + 1;
 	}
 
+	/* Returns the Translation Unit that contains the given position.
+	 * The position has to come from a Span in this SourceMap. */
+	const TranslationUnit& trans_unit_at(size_t pos) const;
+
+	/* Store the parsed tree of a Translation Unit.
+	 * Roots should be added in a fixed order, so that later passes
+	 * see the same package no matter how the files were parsed. */
+	inline void add_ast(std::shared_ptr<ast::FlatTree> tree) { ast_roots.push_back(std::move(tree)); }
+
+	/* A constant reference to the parsed trees in the SourceMap. */
+	inline const std::vector<std::shared_ptr<ast::FlatTree>>& asts() const { return ast_roots; }
+
 	/* A constant reference to the Translation Units in the SourceMap. */
 	inline const std::vector<std::unique_ptr<TranslationUnit>>& trans_units() const { return translation_units; }
 };
\ No newline at end of file
@@ -1,6 +1,25 @@
 #include "span.hpp"
 #include "translation_unit.hpp"
+#include "driver/session.hpp"
 
-TextPos Span::lo_textpos() const { return tu->pos_from_index(lo_bit); }
+const TranslationUnit& Span::trans_unit() const { return Session::source_map.trans_unit_at(lo_bit); }
 
-TextPos Span::hi_textpos() const { return tu->pos_from_index(hi_bit); }
\ No newline at end of file
+TextPos Span::lo_textpos() const {
+	const TranslationUnit& tu = trans_unit();
+	return tu.pos_from_index(lo_bit - tu.start_pos());
+}
+
+TextPos Span::hi_textpos() const {
+	const TranslationUnit& tu = trans_unit();
+	return tu.pos_from_index(hi_bit - tu.start_pos());
+}
+
+WideSpan Span::into_wide() const {
+	// Only search for the Translation Unit once
+	const TranslationUnit& tu = trans_unit();
+	size_t lo = lo_bit - tu.start_pos();
+	size_t hi = hi_bit - tu.start_pos();
+	auto lo_pos = tu.pos_from_index(lo);
+	auto hi_pos = tu.pos_from_index(hi);
+	return WideSpan(tu, lo, lo_pos.line, lo_pos.col, hi, hi_pos.line, hi_pos.col);
+}
\ No newline at end of file
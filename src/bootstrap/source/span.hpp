@@ -1,5 +1,6 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 
 class TranslationUnit;
 
@@ -11,7 +12,7 @@ struct TextPos {
 
 /* A large position in a file.
  * Stores a pointer to the Translation Unit of origin,
- * the absolute start and end positions in the file, as well as
+ * the start and end positions inside of it, as well as
  * the line and column of the start and end. */
 struct WideSpan {
 
@@ -30,22 +31,24 @@ struct WideSpan {
 	{}
 };
 
-/* A position in a file.
- * Stores a pointer to the Translation Unit of origin and
- * the absolute start and end positions in the file. */
+/* A position in the SourceMap.
+ * Stores the start and end positions as offsets into the Session's
+ * SourceMap, which lays every Translation Unit out one after the other.
+ * The Translation Unit of origin is looked up from the offsets. */
 struct Span {
 
-	const TranslationUnit* tu;
-
-	size_t lo_bit = 0;
-	size_t hi_bit = 0;
+	uint32_t lo_bit = 0;
+	uint32_t hi_bit = 0;
 
-	Span() : tu(nullptr) {}
+	Span() = default;
 
-	Span(const TranslationUnit& tu, size_t lo_bit, size_t hi_bit)
-		: tu(&tu), lo_bit(lo_bit), hi_bit(hi_bit)
+	Span(uint32_t lo_bit, uint32_t hi_bit)
+		: lo_bit(lo_bit), hi_bit(hi_bit)
 	{}
 
+	/* Finds the Translation Unit that the Span is from. */
+	const TranslationUnit& trans_unit() const;
+
 	/* Finds the line and column that the Span starts at.
 	 * The position is not stored in the Span, rather it is searched for in the TU. */
 	TextPos lo_textpos() const;
@@ -53,9 +56,5 @@ struct Span {
 	 * The position is not stored in the Span, rather it is searched for in the TU. */
 	TextPos hi_textpos() const;
 
-	WideSpan into_wide() const {
-		auto lo_pos = lo_textpos();
-		auto hi_pos = hi_textpos();
-		return WideSpan(*tu, lo_bit, lo_pos.line, lo_pos.col, hi_bit, hi_pos.line, hi_pos.col);
-	}
+	WideSpan into_wide() const;
 };
\ No newline at end of file
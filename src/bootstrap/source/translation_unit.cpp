@@ -1,62 +1,230 @@
 #include "translation_unit.hpp"
 #include "util/ranges.hpp"
 #include "errors/handler.hpp"
+#include "util/scan.hpp"
+#include "util/utf8.hpp"
+#include "util/hash.hpp"
+#include <algorithm>
+#include <cerrno>
 
-TextPos TranslationUnit::pos_from_index(size_t index) const {
+#if defined(_WIN32)
+	#include <io.h>
+	#define read _read
+	#define close _close
+	#define STDIN_FILENO 0
+#else
+	#include <fcntl.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
 
-	// File has no newlines or it hasn't been entirely lexed
-	if (newlines.empty() || index < newlines[0])
-		return TextPos{0, index};
+void TranslationUnit::index_lines() {
+	std::string_view text = source();
 
-	TextPos pos;
+	// Guess at the average line length to avoid most reallocations
+	line_starts.reserve(text.size() / 32 + 1);
+	line_starts.push_back(0);
+	scan::line_starts(text, 0, line_starts);
+}
 
-	// Find the line that the index is from
-	for (size_t i = 0; i <= newlines.size(); i++) {
-		if (i == newlines.size()) {
-			pos.line = i + 1;
-			pos.col = index - newlines[pos.line - 2] + 1;
-			return pos;
-		}
-		else if (newlines[i] > index) {
-			pos.line = i + 1;
-			pos.col = index - newlines[pos.line - 2] + 1;
-			return pos;
-		}
+bool TranslationUnit::fetch_more() {
+	if (stream_fd < 0)
+		return false;
+
+	// Read in large chunks, but don't wait for a chunk to fill up
+	constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+	long n = -1;
+	if (src.spare_size() == 0) {
+		stream_err = EFBIG;
 	}
+	else {
+		do {
+			n = read(stream_fd, src.spare(), std::min(src.spare_size(), CHUNK_SIZE));
+		} while (n < 0 && errno == EINTR);
 
-	handler->make_bug("failed to retrieve the line corresponding to index " + std::to_string(index)).emit();
-	return pos;
+		if (n < 0)
+			stream_err = errno;
+	}
+
+	// Everything has been read
+	if (n <= 0) {
+		if (stream_fd != STDIN_FILENO)
+			close(stream_fd);
+		stream_fd = -1;
+		check_encoding(true);
+		return false;
+	}
+
+	// Index the new lines
+	size_t old_len = src.size();
+	src.commit((size_t)n);
+	scan::line_starts(source().substr(old_len), old_len, line_starts);
+	check_encoding(false);
+	return true;
 }
 
-std::string TranslationUnit::get_line(size_t ln, bool fmt) const {
+void TranslationUnit::check_encoding(bool at_end) {
+	if (utf8_err)
+		return;
 
-	size_t ln_index = ln - 1;
-	std::string str;
+	auto result = utf8::validate(source().substr(utf8_checked));
+	ascii &= result.ascii;
+	utf8_checked += result.valid;
 
-	// File has no newlines or it hasn't been entirely lexed
-	if (newlines.empty()) {
-		str = src;
+	// The check stopped at a sequence that isn't ASCII
+	if (utf8_checked < src.size()) {
+		ascii = false;
+		// Cut off sequences might be finished by the next chunk of a stream
+		if (at_end || !result.truncated)
+			utf8_err = utf8_checked;
 	}
-	else if (ln_index == 0) {
-		size_t len = newlines[0] - 1;
-		str = src.substr(0, len);
+}
+
+void TranslationUnit::apply_edit(const TextEdit& edit) {
+	if (is_streaming())
+		handler->make_bug("a streamed source can't be edited").emit();
+
+	// Dropped source has to be read back before it can be changed
+	// Once it's changed, it isn't the same as the file anymore
+	source_intact();
+	evicted = false;
+	intact.reset();
+	content_hash.reset();
+
+	// Strings of the tokens that stay the same can point into the text that moves
+	literal_pool->detach();
+
+	src.edit(edit.offset, edit.removed, edit.inserted);
+
+	// Lines that started in the removed text are gone, and the ones after it move along
+	auto first = std::upper_bound(line_starts.begin(), line_starts.end(), edit.offset);
+	auto last = std::upper_bound(first, line_starts.end(), edit.offset + edit.removed);
+	for (auto it = last; it != line_starts.end(); it++)
+		*it += edit.shift();
+
+	std::vector<size_t> added;
+	scan::line_starts(edit.inserted, edit.offset, added);
+	line_starts.insert(line_starts.erase(first, last), added.begin(), added.end());
+
+	recheck_encoding(edit);
+}
+
+void TranslationUnit::recheck_encoding(const TextEdit& edit) {
+	std::string_view text = source();
+
+	// The characters around the edit start and end at the nearest boundaries
+	size_t lo = edit.offset >= 3 ? edit.offset - 3 : 0;
+	while (lo < edit.offset && utf8::is_continuation(text[lo]))
+		lo++;
+	size_t hi = edit.offset + edit.inserted.size();
+	while (hi < text.size() && utf8::is_continuation(text[hi]))
+		hi++;
+	size_t old_hi = hi - edit.shift();
+
+	auto result = utf8::validate(edit.inserted);
+	ascii &= result.ascii && result.valid == edit.inserted.size();
+
+	// Text before the first invalid sequence didn't change
+	if (utf8_err && *utf8_err < lo)
+		return;
+
+	result = utf8::validate(text.substr(lo, hi - lo));
+	if (lo + result.valid < hi) {
+		utf8_err = lo + result.valid;
 	}
-	// We know when the next line begins
-	else if (newlines.size() > ln_index) {
-		size_t start = newlines[ln_index - 1];
-		size_t len = newlines[ln_index] - newlines[ln_index - 1] - 1;
-		str = src.substr(start, len);
+	else if (utf8_err && *utf8_err >= old_hi) {
+		// The first invalid sequence is the same one, after the edit
+		utf8_err = *utf8_err + edit.shift();
 	}
-	else {
-		size_t i = 1;
-		size_t line_start = newlines[ln_index - 1];
-		// Add to length 'i' until newline or EOF
-		while (src.length() > line_start + i && src[line_start + i] != '\n')
-			i++;
-
-		// Get the line
-		str = src.substr(line_start, i);
+	else if (utf8_err) {
+		// The first invalid sequence was edited away, so the rest was never checked
+		auto rest = utf8::validate(text.substr(hi));
+		utf8_err = hi + rest.valid < text.size() ? std::optional<size_t>(hi + rest.valid) : std::nullopt;
 	}
+	utf8_checked = utf8_err ? *utf8_err : text.size();
+}
+
+bool TranslationUnit::evict() {
+	std::lock_guard<std::mutex> lock(evict_lock);
+	if (evicted || is_streaming())
+		return false;
+
+	// Remember what the source was, so it can be checked once it's read back
+	if (!content_hash)
+		content_hash = hash::fnv1a(source());
+	if (!src.drop())
+		return false;
+
+	evicted = true;
+	return true;
+}
+
+bool TranslationUnit::read_back() {
+#if defined(_WIN32)
+	return !src.is_dropped();
+#else
+	// The file might have been replaced since, so it's opened again rather than remapped
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat info;
+	bool same_size = fd >= 0 && fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && (size_t)info.st_size == src.size();
+
+	// Nothing may read the source before it's been restored
+	bool read = src.restore(same_size ? fd : -1);
+	if (fd >= 0)
+		close(fd);
+	return read && hash::fnv1a(source()) == *content_hash;
+#endif
+}
+
+bool TranslationUnit::source_intact() const {
+	std::lock_guard<std::mutex> lock(evict_lock);
+	if (!evicted)
+		return true;
+	// Reading the source back doesn't change what it is
+	if (!intact)
+		intact = const_cast<TranslationUnit*>(this)->read_back();
+	return *intact;
+}
+
+TextPos TranslationUnit::pos_from_index(size_t index) const {
+
+	if (index > src.size()) {
+		handler->make_bug("failed to retrieve the line corresponding to index " + std::to_string(index)).emit();
+		return TextPos{ 0, 0 };
+	}
+
+	// Find the last line that starts at or before the index
+	auto it = std::upper_bound(line_starts.begin(), line_starts.end(), index);
+	size_t line = it - line_starts.begin();
+
+	size_t start = line_starts[line - 1];
+	// Source that changed since it was dropped can't be decoded
+	if (ascii || !source_intact())
+		return TextPos{ line, index - start + 1 };
+
+	// Columns count characters rather than bytes
+	// The byte order mark isn't part of the first line
+	std::string_view text = source();
+	if (start == 0 && text.substr(0, 3) == "\xEF\xBB\xBF")
+		start = std::min<size_t>(3, index);
+	return TextPos{ line, utf8::count(text.substr(start, index - start)) + 1 };
+}
+
+std::string TranslationUnit::get_line(size_t ln, bool fmt) const {
+
+	if (ln == 0 || ln > line_starts.size())
+		return std::string();
+
+	std::string_view text = source();
+
+	// The line ends where the next one starts, minus the newline
+	size_t start = line_starts[ln - 1];
+	size_t end = ln < line_starts.size() ? line_starts[ln] - 1 : text.size();
+	if (end > start && text[end - 1] == '\r')
+		end--;
+
+	std::string str = std::string(text.substr(start, end - start));
 
 	if (fmt) {
 		// Remove whitespace from front and back of line
@@ -1,8 +1,25 @@
 #pragma once
+#include "source_buffer.hpp"
+#include "literal_pool.hpp"
 #include "errors/handler.hpp"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
+/* A change to the text of a Translation Unit.
+ * The 'removed' bytes at 'offset' are replaced by the 'inserted' text. */
+struct TextEdit {
+	size_t offset;
+	size_t removed;
+	std::string_view inserted;
+
+	/* How much further along the text after the edit ends up. */
+	inline int64_t shift() const { return (int64_t)inserted.size() - (int64_t)removed; }
+};
+
 /* An item containing source code, usually a file. 
  * Stores the path to the file of origin and the source.
  * Has a position inside the larger SourceMap. */
@@ -14,27 +31,131 @@ private:
 
 	/* The path to the file from which the source code has been read */
 	const std::string path;
-	/* The full source code from a file */
-	const std::string src;
+	/* The full source code from a file.
+	 * Usually mapped straight from the file, so it's never copied.
+	 * Only grows if the source is being streamed in. */
+	SourceBuffer src;
+
+	/* Where the rest of a streamed source is read from.
+	 * Set to -1 once everything has been read, or if it was never streamed. */
+	int stream_fd = -1;
+	/* The system error code, if reading the stream failed. */
+	int stream_err = 0;
+
+	/* The decoded values of the literals in the source.
+	 * Filled in by the Lexer. Kept across edits,
+	 * so tokens that weren't changed by an edit keep their values. */
+	std::unique_ptr<LiteralPool> literal_pool = std::make_unique<LiteralPool>();
 
 	/* This Translation Unit's start position in the CodeMap */
-	size_t start_position;
+	size_t start_position = 0;
+	/* The end of the positions kept for this unit in the CodeMap, if there's room after the source.
+	 * Room is only left for units that grow through edits. */
+	size_t room_end = 0;
+
+	/* The index at which every line of the source code starts.
+	 * The first line always starts at 0.
+	 * Built once when the source is loaded, so positions can be
+	 * found without having to lex the file first. */
+	std::vector<size_t> line_starts;
+
+	/* True if the source is all ASCII.
+	 * Columns can then be found without decoding the line. */
+	bool ascii = true;
+	/* How much of the source is known to be valid UTF-8. */
+	size_t utf8_checked = 0;
+	/* The position of the first invalid UTF-8 sequence, if there is one. */
+	std::optional<size_t> utf8_err;
 
-	/* The positions of all of the newline markers in the source code.
-	 * Used for getting positions quickly. */
-	std::vector<size_t> newlines;
+	/* True if the source has been dropped from memory.
+	 * It's read back from the file if it's needed again. */
+	bool evicted = false;
+	/* The hash of the source as it was loaded.
+	 * Used to check that dropped source reads back the same. */
+	std::optional<uint64_t> content_hash;
+	/* Set once the source has been read back and checked. */
+	mutable std::optional<bool> intact;
+	/* Held while the source is dropped or read back,
+	 * since errors can be reported from several threads at once. */
+	mutable std::mutex evict_lock;
+
+	/* Scans the source for newlines and fills 'line_starts'. */
+	void index_lines();
+
+	/* Opens the file again and reads the dropped source back from it.
+	 * Returns false if the file isn't the same anymore. */
+	bool read_back();
+
+	/* Checks that the source which hasn't been checked yet is valid UTF-8.
+	 * Unless 'at_end' is set, a sequence cut off by the end of the source
+	 * is checked again once more of the source arrives. */
+	void check_encoding(bool at_end);
+
+	/* Checks the encoding of the source again after an edit.
+	 * Only the edited text and the characters around it are checked,
+	 * unless the first invalid sequence was one of them. */
+	void recheck_encoding(const TextEdit& edit);
 
 public:
-	explicit TranslationUnit(ErrorHandler& handler, const std::string& src) 
-		: handler(&handler), src(src) {}
+	TranslationUnit(ErrorHandler& handler, const std::string& path, SourceBuffer&& src, size_t start_pos) 
+		: handler(&handler), path(path), src(std::move(src)), start_position(start_pos) { index_lines(); check_encoding(true); }
+
+	/* Creates a Translation Unit that reads its source from a stream, like a pipe.
+	 * The source is read as it's needed, into space reserved in the buffer.
+	 * The stream is closed once it's been read, unless it's the standard input. */
+	TranslationUnit(ErrorHandler& handler, const std::string& name, int fd, SourceBuffer&& reserved, size_t start_pos)
+		: handler(&handler), path(name), src(std::move(reserved)), stream_fd(fd), start_position(start_pos) { index_lines(); check_encoding(false); }
 
-	TranslationUnit(ErrorHandler& handler, const std::string& path, const std::string& src, size_t start_pos) 
-		: handler(&handler), path(path), src(src), start_position(start_pos) {}
+	/* Reads the next chunk of a streamed source.
+	 * Blocks until some of it arrives.
+	 * Returns false if there's nothing left to read. */
+	bool fetch_more();
+
+	/* Reads all of the rest of a streamed source. */
+	inline void fetch_all() { while (fetch_more()); }
+
+	/* Changes the source in place.
+	 * The line table and encoding check are only updated around the edit.
+	 * The source can't still be streaming. Use 'SourceMap::apply_edit',
+	 * which makes sure the positions of the unit have room for the edit. */
+	void apply_edit(const TextEdit& edit);
+
+	/* Moves the unit to another start position in the CodeMap,
+	 * keeping the positions up to 'room' free for it to grow into. */
+	inline void move_to(size_t start, size_t room)	{ start_position = start; room_end = room; }
+
+	/* True if more of the source might still arrive. */
+	inline bool is_streaming() const			{ return stream_fd >= 0; }
+	/* The system error code, if reading the stream failed. */
+	inline int stream_error() const				{ return stream_err; }
+
+	/* Remembers the hash of the source as it was loaded. */
+	inline void set_content_hash(uint64_t hash)	{ content_hash = hash; }
+
+	/* Drops the source from memory, keeping only its line table, hash and path.
+	 * The source mustn't be read again until 'source_intact' has read it back,
+	 * after which views into it are valid again.
+	 * Returns false if the source can't be dropped, like if it wasn't from a file. */
+	bool evict();
+
+	/* True if the source has been dropped from memory. */
+	inline bool is_evicted() const				{ return evicted; }
+
+	/* Reads a dropped source back from its file, and checks that it's the same as it was before.
+	 * The file might have been changed while compiling, in which case the
+	 * source can't be used anymore. It's left as zeroes if the size changed.
+	 * Always true if the source was never dropped. */
+	bool source_intact() const;
+
+	/* True if the source is all ASCII, as far as it has been read. */
+	inline bool is_ascii() const				{ return ascii; }
+	/* The position of the first invalid UTF-8 sequence, if there is one. */
+	inline std::optional<size_t> utf8_error() const	{ return utf8_err; }
 
 	std::string this_source_line(size_t index) const;
 
-	/* Returns the line of source that the index was from.
-	 * Beginning and ending whitespace is removed. */
+	/* Returns the line and column that the index is at.
+	 * Both of them start counting from 1. */
 	TextPos pos_from_index(size_t index) const;
 
 	/* Returns the line of source that the index was from.
@@ -42,19 +163,23 @@ public:
 	 * Tab characters are replaced by four spaces. */
 	std::string get_line(size_t ln, bool fmt) const;
 
-	/* Save a newline position.
-	 * Getting positions from an index relies on this. */
-	void save_newline(size_t index) {
-		newlines.push_back(index);
-	}
+	/* Number of lines in the source code. */
+	inline size_t line_count() const			{ return line_starts.size(); }
 
 	/* Returns the path to Translation Unit. */
 	inline const std::string& filepath() const	{ return path; }
 	/* A view into the file's source code. */
-	inline std::string_view source() const		{ return src; }
+	inline std::string_view source() const		{ return src.view(); }
+
+	/* The decoded values of the literals in the source. */
+	inline LiteralPool& literals()				{ return *literal_pool; }
+	inline const LiteralPool& literals() const	{ return *literal_pool; }
 
 	/* Start position in the CodeMap. */
 	inline size_t start_pos() const				{ return start_position; }
 	/* End position in the CodeMap. */
-	inline size_t end_pos() const				{ return start_position + src.length(); }
+	inline size_t end_pos() const				{ return start_position + src.size(); }
+	/* The last position kept for this unit in the CodeMap.
+	 * Past the end of the source if there's room for it to grow. */
+	inline size_t room_end_pos() const			{ return std::max(end_pos(), room_end); }
 };
\ No newline at end of file
@@ -1,16 +1,48 @@
 #include "lexer_tests.hpp"
 #include "lexer/lexer.hpp"
+#include "lexer/parallel_lexer.hpp"
+#include "driver/session.hpp"
 #include "util/token_info.hpp"
+#include "util/utf8.hpp"
+#include <algorithm>
 
 namespace tests {
 	namespace lexer {
-		
+
+		/* Checks that two tokens are the same, in their text and in the values they were given.
+		 * Positions count from the start of each token's Translation Unit. Literals are compared
+		 * by their decoded values, and also by their ids if 'same_ids' is set.
+		 * Prints why the test failed if they aren't the same. */
+		static bool same_token(const char* test, size_t i, const Token& tk, const TranslationUnit& tu, const Token& other, const TranslationUnit& other_tu, bool same_ids) {
+			bool same = tk.type() == other.type() && tk.raw() == other.raw()
+				&& tk.span().lo_bit - tu.start_pos() == other.span().lo_bit - other_tu.start_pos()
+				&& tk.span().hi_bit - tu.start_pos() == other.span().hi_bit - other_tu.start_pos();
+
+			if (same) {
+				const LiteralPool& pool = tu.literals();
+				const LiteralPool& other_pool = other_tu.literals();
+				switch (tk.type()) {
+					case (int)TokenType::LIT_INTEGER:	same = pool.integer(tk.literal()) == other_pool.integer(other.literal()); break;
+					case (int)TokenType::LIT_FLOAT:		same = pool.floating(tk.literal()) == other_pool.floating(other.literal()); break;
+					case (int)TokenType::LIT_CHAR:		same = pool.character(tk.literal()) == other_pool.character(other.literal()); break;
+					case (int)TokenType::LIT_STRING:	same = pool.string(tk.literal()) == other_pool.string(other.literal()); break;
+					// Symbols are shared by every unit
+					default:							same = tk.payload() == other.payload(); break;
+				}
+				same &= !same_ids || tk.payload() == other.payload();
+			}
+
+			if (!same)
+				printf("FAILED %s; token %lu is '%s' instead of '%s'\n", test, i, std::string(tk.raw()).substr(0, 16).c_str(), std::string(other.raw()).substr(0, 16).c_str());
+			return same;
+		}
+
 		void token_has_correct_absolute_pos() {
 			// Give the Lexer a string of text
 			// The numbers should correspond to absolute positions in the TU
 			Emitter emitter;
 			ErrorHandler handler(emitter);
-			TranslationUnit tu = TranslationUnit(handler, "\n12345\n7\n9");
+			TranslationUnit& tu = Session::source_map.load_source("test", "\n12345\n7\n9");
 			Lexer lex(tu, handler);
 			
 			// Retrieve the first token
@@ -18,7 +50,8 @@ namespace tests {
 			Token tk = lex.next_token();
 
 			// Check for correct absolute position
-			if (tk.span().lo_bit == 1 || tk.span().hi_bit == 5) {
+			// Spans are positions in the SourceMap, so they start at the TU's position
+			if (tk.span().lo_bit == tu.start_pos() + 1 || tk.span().hi_bit == tu.start_pos() + 5) {
 				printf("COMPLETED token_has_correct_absolute_pos\n");
 				return;
 			}
@@ -26,7 +59,7 @@ namespace tests {
 			// The lexer has assigned the wrong position
 			// Either location tracking is broken,
 			// or some token's positon isn't being set correctly
-			printf("FAILED token_has_correct_location; the token's absolute position was wrong (%lu, %lu)\n", tk.span().lo_bit, tk.span().hi_bit);
+			printf("FAILED token_has_correct_location; the token's absolute position was wrong (%u, %u)\n", tk.span().lo_bit, tk.span().hi_bit);
 		}
 
 		void token_has_correct_line_pos() {
@@ -34,7 +67,7 @@ namespace tests {
 			// The numbers should correspond to absolute positions in the TU
 			Emitter emitter;
 			ErrorHandler handler(emitter);
-			TranslationUnit tu = TranslationUnit(handler, "\n12345\n7\n9");
+			TranslationUnit& tu = Session::source_map.load_source("test", "\n12345\n7\n9");
 			Lexer lex(tu, handler);
 			
 			// Retrieve the first token
@@ -60,7 +93,7 @@ namespace tests {
 			// The numbers should correspond to absolute positions in the TU
 			Emitter emitter;
 			ErrorHandler handler(emitter);
-			TranslationUnit tu = TranslationUnit(handler, "\n12345\n7\n9");
+			TranslationUnit& tu = Session::source_map.load_source("test", "\n12345\n7\n9");
 			Lexer lex(tu, handler);
 			
 			// Retrieve the first token
@@ -81,11 +114,402 @@ namespace tests {
 			printf("FAILED token_has_correct_column_pos; the token's column position was wrong (%lu, %lu)\n", lo_pos.col, hi_pos.col);
 		}
 
+		void token_on_first_line_has_correct_pos() {
+			// Give the Lexer a string of text
+			// The first token comes before any newline in the TU
+			Emitter emitter;
+			ErrorHandler handler(emitter);
+			TranslationUnit& tu = Session::source_map.load_source("test", "  123\n5");
+			Lexer lex(tu, handler);
+
+			// Retrieve the first token
+			// Should be '123'
+			Token tk = lex.next_token();
+			auto lo_pos = tk.span().lo_textpos();
+
+			// Check for correct line and column position
+			if (lo_pos.line == 1 && lo_pos.col == 3) {
+				printf("COMPLETED token_on_first_line_has_correct_pos\n");
+				return;
+			}
+
+			// The line index has the wrong start for the first line
+			printf("FAILED token_on_first_line_has_correct_pos; the token's position was wrong (%lu, %lu)\n", lo_pos.line, lo_pos.col);
+		}
+
+		void unicode_identifier_is_one_token() {
+			// Give the Lexer an identifier with non-ASCII letters
+			// The column should count characters, not bytes
+			Emitter emitter;
+			ErrorHandler handler(emitter);
+			TranslationUnit& tu = Session::source_map.load_source("test", "\xc3\xa4 n\xc3\xa4me\xcc\x81 ");
+			Lexer lex(tu, handler);
+
+			// Retrieve the second token
+			// Should be 'näme' with a combining accent
+			lex.next_token();
+			Token tk = lex.next_token();
+			auto lo_pos = tk.span().lo_textpos();
+
+			// Check for the whole identifier and its column
+			if (tk == TokenType::ID && tk.raw().size() == 7 && lo_pos.col == 3) {
+				printf("COMPLETED unicode_identifier_is_one_token\n");
+				return;
+			}
+
+			// Non-ASCII characters were not decoded as identifier characters
+			printf("FAILED unicode_identifier_is_one_token; the identifier was split or misplaced (%s, %lu)\n", translate::tk_type(tk).c_str(), lo_pos.col);
+		}
+
+		void unicode_lifetime_is_one_token() {
+			// Give the Lexer lifetimes that start with and contain non-ASCII letters
+			Emitter emitter;
+			ErrorHandler handler(emitter);
+			TranslationUnit& tu = Session::source_map.load_source("test", "'\xc3\xa4" "b 'a\xc3\xa4 ");
+			Lexer lex(tu, handler);
+
+			// Both should be whole lifetimes, the accent included
+			const char* expected[] = { "'\xc3\xa4" "b", "'a\xc3\xa4" };
+			for (auto raw : expected) {
+				Token tk = lex.next_token();
+				if (tk != TokenType::LF || tk.raw() != raw) {
+					printf("FAILED unicode_lifetime_is_one_token; '%s' was lexed as %s\n", std::string(tk.raw()).c_str(), translate::tk_type(tk).c_str());
+					return;
+				}
+			}
+
+			if (handler.has_errors()) {
+				printf("FAILED unicode_lifetime_is_one_token; the lifetimes were reported as errors\n");
+				return;
+			}
+
+			printf("COMPLETED unicode_lifetime_is_one_token\n");
+		}
+
+		void keywords_are_distinguished_from_identifiers() {
+			// Give the Lexer keywords mixed with identifiers that look almost like them
+			Emitter emitter;
+			ErrorHandler handler(emitter);
+			TranslationUnit& tu = Session::source_map.load_source("test", "while where whale continue continues i8 i9 mut mu");
+			Lexer lex(tu, handler);
+
+			TokenType expected[] = {
+				TokenType::WHILE, TokenType::WHERE, TokenType::ID, TokenType::CONTINUE, TokenType::ID,
+				TokenType::I8, TokenType::ID, TokenType::MUT, TokenType::ID
+			};
+
+			// Every token should match its expected type
+			for (auto type : expected) {
+				Token tk = lex.next_token();
+				if (tk != type) {
+					printf("FAILED keywords_are_distinguished_from_identifiers; '%s' was lexed as %s\n", std::string(tk.raw()).c_str(), translate::tk_type(tk).c_str());
+					return;
+				}
+			}
+
+			printf("COMPLETED keywords_are_distinguished_from_identifiers\n");
+		}
+
+		void token_buffer_matches_lexer() {
+			// Give the Lexer literals, including an invalid one, and a token at EOF
+			Emitter emitter;
+			ErrorHandler handler(emitter);
+			// Both read the same text from their own unit, so they give out the same literal ids
+			const char* text = "var s = \"a\\qb\" + 'c' <-> \"d\" 'lt x 12 3.5";
+			TranslationUnit& tu = Session::source_map.load_source("test", text);
+			TranslationUnit& buffered_tu = Session::source_map.load_source("test", text);
+			Lexer lex(tu, handler);
+			TokenBuffer tokens = Lexer(buffered_tu, handler).tokenize_all();
+
+			// Every buffered token should be the same as the one read directly
+			for (size_t i = 0; i < tokens.size(); i++) {
+				if (!same_token("token_buffer_matches_lexer", i, tokens.token(i), buffered_tu, lex.next_token(), tu, true))
+					return;
+			}
+
+			// The buffer should end where the source does
+			if (tokens.type(tokens.size() - 1) != (int)TokenType::END) {
+				printf("FAILED token_buffer_matches_lexer; the buffer doesn't end with an END token\n");
+				return;
+			}
+
+			printf("COMPLETED token_buffer_matches_lexer\n");
+		}
+
+		void parallel_lexer_matches_lexer() {
+			// Give the ParallelLexer enough text for three chunks,
+			// with a block comment over the first split and a string over the second
+			Emitter emitter;
+			ErrorHandler handler(emitter);
+			const std::string line = "var x = 1 + 2;\n";
+			std::string text;
+			while (text.size() < 3 * ParallelLexer::MIN_CHUNK_SIZE + line.size())
+				text += line;
+
+			// Chunks are split at the first line start after every third of the text
+			size_t span = 64 * line.size();
+			size_t comment_at = text.size() / 3 - span;
+			comment_at -= comment_at % line.size();
+			text.replace(comment_at, 2, "/*");
+			text.replace(comment_at + 2 * span - 3, 2, "*/");
+			// A chunk that starts in the comment reads names and literals that aren't there
+			for (size_t at = comment_at + span; at < comment_at + 2 * span - line.size(); at += line.size())
+				text.replace(at, line.size(), "qzqzqzqzq = 3;\n");
+
+			size_t string_at = text.size() / 3 * 2 - span;
+			string_at -= string_at % line.size();
+			text.replace(string_at, 1, "\"");
+			text.replace(string_at + 2 * span - 2, 1, "\"");
+
+			// Each lexes its own copy, so their literal ids can be compared
+			TranslationUnit& expected_tu = Session::source_map.load_source("serial", text);
+			TranslationUnit& tu = Session::source_map.load_source("test", text);
+			TokenBuffer expected = Lexer(expected_tu, handler).tokenize_all();
+			size_t names = Session::symbols.size();
+			TokenBuffer tokens = ParallelLexer(tu, handler, 3).tokenize_all();
+
+			// Every token should be the same as the one a single Lexer read
+			if (tokens.size() != expected.size()) {
+				printf("FAILED parallel_lexer_matches_lexer; got %lu tokens instead of %lu\n", tokens.size(), expected.size());
+				return;
+			}
+			for (size_t i = 0; i < expected.size(); i++) {
+				if (!same_token("parallel_lexer_matches_lexer", i, tokens.token(i), tu, expected.token(i), expected_tu, true))
+					return;
+			}
+
+			// Tokens that were thrown away shouldn't have left literals or names behind
+			if (tu.literals().size() != expected_tu.literals().size() || Session::symbols.size() != names) {
+				printf("FAILED parallel_lexer_matches_lexer; %lu literals and %lu new names instead of %lu and none\n", tu.literals().size(), Session::symbols.size() - names, expected_tu.literals().size());
+				return;
+			}
+
+			// Neither of them should have found anything wrong
+			if (handler.has_errors()) {
+				printf("FAILED parallel_lexer_matches_lexer; valid text was reported as an error\n");
+				return;
+			}
+
+			printf("COMPLETED parallel_lexer_matches_lexer\n");
+		}
+
+		void literals_are_decoded() {
+			// Give the Lexer literals in every base, with escapes and at the limits of their types
+			Emitter emitter;
+			ErrorHandler handler(emitter);
+			TranslationUnit& tu = Session::source_map.load_source("test", "0x7fffffffffffffff 0b101 0o17 18446744073709551615 2.5e-3 .5 '\\u4e2d' \"a\\tb\\\"\"");
+			Lexer lex(tu, handler);
+			const LiteralPool& pool = tu.literals();
+
+			uint64_t integers[] = { 0x7fffffffffffffff, 5, 15, 18446744073709551615ull };
+			for (uint64_t expected : integers) {
+				Token tk = lex.next_token();
+				if (tk != TokenType::LIT_INTEGER || pool.integer(tk.literal()) != expected) {
+					printf("FAILED literals_are_decoded; '%s' wasn't decoded as %lu\n", std::string(tk.raw()).c_str(), expected);
+					return;
+				}
+			}
+
+			double floats[] = { 2.5e-3, 0.5 };
+			for (double expected : floats) {
+				Token tk = lex.next_token();
+				if (tk != TokenType::LIT_FLOAT || pool.floating(tk.literal()) != expected) {
+					printf("FAILED literals_are_decoded; '%s' wasn't decoded as %g\n", std::string(tk.raw()).c_str(), expected);
+					return;
+				}
+			}
+
+			Token tk = lex.next_token();
+			if (tk != TokenType::LIT_CHAR || pool.character(tk.literal()) != 0x4e2d) {
+				printf("FAILED literals_are_decoded; '%s' wasn't decoded as U+4E2D\n", std::string(tk.raw()).c_str());
+				return;
+			}
+
+			tk = lex.next_token();
+			if (tk != TokenType::LIT_STRING || pool.string(tk.literal()) != "a\tb\"") {
+				printf("FAILED literals_are_decoded; the escapes in '%s' weren't decoded\n", std::string(tk.raw()).c_str());
+				return;
+			}
+
+			// None of them should have been reported
+			if (handler.has_errors()) {
+				printf("FAILED literals_are_decoded; valid literals were reported as errors\n");
+				return;
+			}
+
+			printf("COMPLETED literals_are_decoded\n");
+		}
+
+		void identifiers_share_symbols() {
+			// Give two Lexers the same names in different files
+			Emitter emitter;
+			ErrorHandler handler(emitter);
+			TranslationUnit& tu = Session::source_map.load_source("test", "foo bar foo 'a");
+			TranslationUnit& other_tu = Session::source_map.load_source("other", "bar 'a");
+			Lexer lex(tu, handler);
+			Lexer other(other_tu, handler);
+
+			Token foo = lex.next_token();
+			Token bar = lex.next_token();
+			Token foo_again = lex.next_token();
+			Token lf = lex.next_token();
+
+			// Equal names should have the same symbol, even from another file
+			if (foo.symbol() != foo_again.symbol() || foo.symbol() == bar.symbol()) {
+				printf("FAILED identifiers_share_symbols; 'foo' and 'bar' weren't told apart by their symbols\n");
+				return;
+			}
+			if (other.next_token().symbol() != bar.symbol() || other.next_token().symbol() != lf.symbol()) {
+				printf("FAILED identifiers_share_symbols; names in another file got different symbols\n");
+				return;
+			}
+
+			// The symbol should give back the name
+			if (Session::symbols.name(foo.symbol()) != "foo" || Session::symbols.name(lf.symbol()) != "'a") {
+				printf("FAILED identifiers_share_symbols; the symbol of 'foo' is named '%s'\n", std::string(Session::symbols.name(foo.symbol())).c_str());
+				return;
+			}
+
+			printf("COMPLETED identifiers_share_symbols\n");
+		}
+
+		void relex_matches_full_lex() {
+			// Edit a number, a comment and the text around a string, one after another
+			Emitter emitter;
+			ErrorHandler handler(emitter);
+			TranslationUnit& tu = Session::source_map.load_source("test", "fun main() {\n\tvar x = 123; // note\n\tvar y = x + 1;\n\treturn y;\n}\n");
+			TokenBuffer tokens = Lexer(tu, handler).tokenize_all();
+			// Another unit follows it, so it has to move once it grows
+			Session::source_map.load_source("next", "fun next() {}\n");
+			size_t units = Session::source_map.trans_units().size();
+
+			struct Case {
+				TextEdit edit;
+				// The most tokens the edit should have to lex again
+				size_t most;
+			};
+			Case cases[] = {
+				{ { 24, 0, "5" }, 2 },
+				{ { 31, 4, "a + b" }, 2 },
+				{ { 46, 1, "\"}\"" }, 3 },
+				{ { 12, 0, "var z = 0.5;\n" }, 9 }
+			};
+
+			for (auto& c : cases) {
+				Session::source_map.apply_edit(tu, c.edit);
+				Lexer::TokenChange change = Lexer(tu, handler).relex(tokens, c.edit);
+				TokenBuffer full = Lexer(tu, handler).tokenize_all();
+
+				// The updated tokens should be the same as lexing the whole edited text
+				if (tokens.size() != full.size()) {
+					printf("FAILED relex_matches_full_lex; got %lu tokens instead of %lu\n", tokens.size(), full.size());
+					return;
+				}
+				// Tokens that weren't lexed again keep their old literal ids
+				for (size_t i = 0; i < full.size(); i++) {
+					if (!same_token("relex_matches_full_lex", i, tokens.token(i), tu, full.token(i), tu, false))
+						return;
+				}
+
+				// Only the tokens around the edit should have been lexed again
+				if (change.new_end - change.first > c.most) {
+					printf("FAILED relex_matches_full_lex; %lu tokens were lexed again for an edit at %lu\n", change.new_end - change.first, c.edit.offset);
+					return;
+				}
+
+				// Strings that weren't lexed again should keep their values, even though the text moved
+				for (size_t i = 0; i < tokens.size(); i++) {
+					if (tokens.type(i) == (int)TokenType::LIT_STRING && tu.literals().string(tokens.literal(i)) != tokens.raw(i)) {
+						printf("FAILED relex_matches_full_lex; the string at token %lu is '%s'\n", i, std::string(tu.literals().string(tokens.literal(i))).c_str());
+						return;
+					}
+				}
+
+				// The unit is edited in place, with its lines updated, and its positions still lead to it
+				size_t lines = std::count(tu.source().begin(), tu.source().end(), '\n') + 1;
+				if (Session::source_map.trans_units().size() != units || tu.line_count() != lines || &Session::source_map.trans_unit_at(tu.end_pos()) != &tu) {
+					printf("FAILED relex_matches_full_lex; the edit made a new unit or has %lu lines instead of %lu\n", tu.line_count(), lines);
+					return;
+				}
+			}
+
+			printf("COMPLETED relex_matches_full_lex\n");
+		}
+
+		void edit_rechecks_encoding() {
+			// The invalid byte is edited away, then another one is added further in
+			TranslationUnit& tu = Session::source_map.load_source("test", "var a = \"\xff\";\nvar b = \"\xc3\xa9\";\n");
+			if (tu.utf8_error() != std::optional<size_t>(9)) {
+				printf("FAILED edit_rechecks_encoding; the invalid byte wasn't found\n");
+				return;
+			}
+
+			Session::source_map.apply_edit(tu, TextEdit{ 9, 1, "\xc3\xa9" });
+			if (tu.utf8_error()) {
+				printf("FAILED edit_rechecks_encoding; an error at %lu is left after fixing it\n", *tu.utf8_error());
+				return;
+			}
+
+			// Cutting a character in half is an error too
+			Session::source_map.apply_edit(tu, TextEdit{ 24, 1, "" });
+			if (tu.utf8_error() != std::optional<size_t>(23)) {
+				printf("FAILED edit_rechecks_encoding; a cut off character wasn't found\n");
+				return;
+			}
+
+			printf("COMPLETED edit_rechecks_encoding\n");
+		}
+
+		void long_text_encoding_errors_are_found() {
+			// Sequences of every length, long enough to be checked in blocks
+			std::string text;
+			for (int i = 0; i < 10; i++)
+				text += "ab\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80 ";
+
+			utf8::Validation result = utf8::validate(text);
+			if (result.valid != text.size() || result.truncated || result.ascii) {
+				printf("FAILED long_text_encoding_errors_are_found; valid text stopped at %lu\n", result.valid);
+				return;
+			}
+			if (!utf8::validate(std::string(100, 'a')).ascii) {
+				printf("FAILED long_text_encoding_errors_are_found; ASCII text wasn't found to be ASCII\n");
+				return;
+			}
+
+			// A stray continuation, an overlong form, a surrogate and a value past U+10FFFF
+			const char* invalid[] = { "\x80", "\xc0\x80", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\xc3" "a" };
+
+			// Every place a sequence starts, inside a block or across the edge of one,
+			// should be found as the end of the valid text
+			for (size_t at = 0; at < text.size(); at++) {
+				if (utf8::is_continuation(text[at]))
+					continue;
+
+				for (auto bad : invalid) {
+					std::string broken = text.substr(0, at) + bad + text.substr(at);
+					result = utf8::validate(broken);
+					if (result.valid != at || result.truncated) {
+						printf("FAILED long_text_encoding_errors_are_found; an error at %lu was found at %lu\n", at, result.valid);
+						return;
+					}
+				}
+
+				// A character cut off by the end of the text
+				result = utf8::validate(text.substr(0, at) + "\xf0\x9f\x98");
+				if (result.valid != at || !result.truncated) {
+					printf("FAILED long_text_encoding_errors_are_found; a cut off character at %lu wasn't found\n", at);
+					return;
+				}
+			}
+
+			printf("COMPLETED long_text_encoding_errors_are_found\n");
+		}
+
 		void return_eof_without_translation_unit() {
 			// Create a Lexer with no text in the TU
 			Emitter emitter;
 			ErrorHandler handler(emitter);
-			TranslationUnit tu = TranslationUnit(handler, "");
+			TranslationUnit& tu = Session::source_map.load_source("test", "");
 			Lexer lex(tu, handler);
 
 			// Retrieve the first token
@@ -6,6 +6,17 @@ namespace tests {
 		void token_has_correct_absolute_pos();
 		void token_has_correct_line_pos();
 		void token_has_correct_column_pos();
+		void token_on_first_line_has_correct_pos();
+		void unicode_identifier_is_one_token();
+		void unicode_lifetime_is_one_token();
+		void keywords_are_distinguished_from_identifiers();
+		void token_buffer_matches_lexer();
+		void parallel_lexer_matches_lexer();
+		void literals_are_decoded();
+		void identifiers_share_symbols();
+		void relex_matches_full_lex();
+		void edit_rechecks_encoding();
+		void long_text_encoding_errors_are_found();
 		
 		void return_eof_without_translation_unit();
 
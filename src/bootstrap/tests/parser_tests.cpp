@@ -0,0 +1,29 @@
+#include "parser_tests.hpp"
+#include "parser/parser.hpp"
+#include "driver/session.hpp"
+
+namespace tests {
+	namespace parser {
+
+		void unfinished_expression_is_reported() {
+			// The operator is missing its right operand, and the second function its closing brace
+			// Parsing used to skip to the end of the file and never stop
+			DeferredEmitter emitter;
+			ErrorHandler handler(emitter);
+			TranslationUnit& tu = Session::source_map.load_source("test", "fun f() { return 1 + 2 + ; }\nfun g() { return 3;\n");
+
+			try {
+				Parser(handler, Session::source_map, tu).parse();
+			}
+			catch (const CompilerException& e) {}
+
+			if (!handler.has_errors()) {
+				printf("FAILED unfinished_expression_is_reported; the missing operand wasn't reported\n");
+				return;
+			}
+
+			printf("COMPLETED unfinished_expression_is_reported\n");
+		}
+
+	}
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+namespace tests {
+	namespace parser {
+
+		void unfinished_expression_is_reported();
+
+	}
+}
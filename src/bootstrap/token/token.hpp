@@ -1,6 +1,8 @@
 #pragma once
 #include "token_type.hpp"
 #include "source/span.hpp"
+#include "source/literal_pool.hpp"
+#include "util/interner.hpp"
 #include <string>
 
 /* The token class.
@@ -12,6 +14,10 @@ class Token {
 	 * Assign with a TokenType enumerator for complex types, e.g TokenType::ID */
 	int ty = (int)TokenType::END;
 
+	/* The id of a literal's decoded value in the Translation Unit's LiteralPool,
+	 * or the interned name of an identifier or lifetime. */
+	uint32_t value = 0;
+
 	/* The literal string of text that the token was built from. */
 	std::string_view raw_str;
 
@@ -19,6 +25,9 @@ class Token {
 	Span tk_span;
 
 public:
+	/* Create an 'END' token with no text or location. */
+	Token() = default;
+
 	/* Create a token from it's type, location
 	 * and store it's string literal. */
 	Token(TokenType type, std::string_view str, const Span& sp)
@@ -29,6 +38,15 @@ public:
 	Token(int type, std::string_view str, const Span& sp)
 		: ty(type), raw_str(str), tk_span(sp) {}
 
+	/* Create a token from it's type, location, string literal
+	 * and the id of it's decoded value or interned name. */
+	Token(int type, std::string_view str, const Span& sp, uint32_t value)
+		: ty(type), value(value), raw_str(str), tk_span(sp) {}
+	/* Create a token from it's type, location, string literal
+	 * and the id of it's decoded value or interned name. */
+	Token(TokenType type, std::string_view str, const Span& sp, uint32_t value)
+		: ty((int)type), value(value), raw_str(str), tk_span(sp) {}
+
 	/* Returns the type of the token.
 	 * If the return is 0, the file has reached EOF.
 	 * If the return is under 256, it can be cast to a character.
@@ -45,6 +63,13 @@ public:
 	/* Returns the literal string of text that the token was built from. */
 	inline std::string_view raw() const { return raw_str; }
 
+	/* Returns the id of a literal's decoded value in the Translation Unit's LiteralPool. */
+	inline LiteralId literal() const { return value; }
+	/* Returns the interned name of an identifier or lifetime. */
+	inline Symbol symbol() const { return value; }
+	/* Returns the literal id or symbol, whichever the token has. */
+	inline uint32_t payload() const { return value; }
+
 	bool operator==(const TokenType& other) const {
 		return ty == (int)other;
 	}
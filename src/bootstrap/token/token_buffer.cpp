@@ -0,0 +1,112 @@
+#include "token_buffer.hpp"
+#include "source/translation_unit.hpp"
+#include <algorithm>
+
+void TokenBuffer::reserve(size_t n) {
+	types.reserve(n);
+	starts.reserve(n);
+	lengths.reserve(n);
+	payloads.reserve(n);
+}
+
+void TokenBuffer::push(const Token& tk) {
+	uint32_t index = types.size();
+	types.push_back((uint16_t)tk.type());
+	starts.push_back(tk.span().lo_bit - tu->start_pos());
+	lengths.push_back(tk.span().hi_bit - tk.span().lo_bit);
+	payloads.push_back(tk.payload());
+
+	// Remember the text if it can't be found again from the span
+	if (tk.raw() != source_text(index)) {
+		types.back() |= REPLACED;
+		replaced.emplace_back(index, tk.raw());
+	}
+}
+
+void TokenBuffer::append(const TokenBuffer& other, size_t from, size_t to) {
+	size_t offset = types.size();
+	types.insert(types.end(), other.types.begin() + from, other.types.begin() + to);
+	starts.insert(starts.end(), other.starts.begin() + from, other.starts.begin() + to);
+	lengths.insert(lengths.end(), other.lengths.begin() + from, other.lengths.begin() + to);
+	payloads.insert(payloads.end(), other.payloads.begin() + from, other.payloads.begin() + to);
+
+	// Replaced text moves over with the new indices of its tokens
+	for (auto& [index, text] : other.replaced)
+		if (index >= from && index < to)
+			replaced.emplace_back(index - from + offset, text);
+}
+
+void TokenBuffer::splice(size_t from, size_t to, const TokenBuffer& with, int64_t shift) {
+	for (size_t i = to; i < starts.size(); i++)
+		starts[i] += shift;
+
+	// Replaced text keeps its order, with the indices after the splice moved along
+	std::vector<std::pair<uint32_t, std::string_view>> moved;
+	for (auto& [index, text] : replaced)
+		if (index < from)
+			moved.emplace_back(index, text);
+	for (auto& [index, text] : with.replaced)
+		moved.emplace_back(index + from, text);
+	for (auto& [index, text] : replaced)
+		if (index >= to)
+			moved.emplace_back(index - to + from + with.size(), text);
+	replaced = std::move(moved);
+
+	types.erase(types.begin() + from, types.begin() + to);
+	types.insert(types.begin() + from, with.types.begin(), with.types.end());
+	starts.erase(starts.begin() + from, starts.begin() + to);
+	starts.insert(starts.begin() + from, with.starts.begin(), with.starts.end());
+	lengths.erase(lengths.begin() + from, lengths.begin() + to);
+	lengths.insert(lengths.begin() + from, with.lengths.begin(), with.lengths.end());
+	payloads.erase(payloads.begin() + from, payloads.begin() + to);
+	payloads.insert(payloads.begin() + from, with.payloads.begin(), with.payloads.end());
+
+	tu = with.tu;
+}
+
+std::optional<size_t> TokenBuffer::ending_at(uint32_t pos) const {
+	// Tokens end in order, so look for the first one that ends at or after 'pos'
+	size_t lo = 0;
+	size_t hi = types.size();
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (end(mid) < pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < types.size() && end(lo) == pos)
+		return lo;
+	return std::nullopt;
+}
+
+std::string_view TokenBuffer::source_text(size_t i) const {
+	auto text = tu->source().substr(starts[i], lengths[i]);
+
+	// Literals don't include their quotes
+	if ((type(i) == (int)TokenType::LIT_STRING || type(i) == (int)TokenType::LIT_CHAR) && text.size() >= 2)
+		return text.substr(1, text.size() - 2);
+	return text;
+}
+
+std::string_view TokenBuffer::raw(size_t i) const {
+	if (types[i] & REPLACED) {
+		auto it = std::lower_bound(replaced.begin(), replaced.end(), i,
+			[](const std::pair<uint32_t, std::string_view>& r, size_t i) { return r.first < i; });
+		return it->second;
+	}
+	return source_text(i);
+}
+
+Span TokenBuffer::span(size_t i) const {
+	uint32_t lo = tu->start_pos() + starts[i];
+	return Span(lo, lo + lengths[i]);
+}
+
+Token TokenBuffer::token(size_t i) const {
+	// Stay on the 'END' token
+	if (i >= types.size())
+		i = types.size() - 1;
+	return Token(type(i), raw(i), span(i), payloads[i]);
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include "token.hpp"
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+class TranslationUnit;
+
+/* Every token of a Translation Unit, in order.
+ * Tokens are split up into parallel arrays of types, starts and lengths,
+ * so walking over them only touches the parts that are needed.
+ * The last token is always an 'END' token.
+ * Build one with 'Lexer::tokenize_all()'. */
+class TokenBuffer {
+
+private:
+	/* The Translation Unit the tokens were read from. */
+	const TranslationUnit* tu;
+
+	/* The type of every token.
+	 * Types that have the 'REPLACED' bit set have their text in 'replaced'. */
+	std::vector<uint16_t> types;
+	/* Where every token starts in the Translation Unit. */
+	std::vector<uint32_t> starts;
+	/* The length of every token in the source. */
+	std::vector<uint32_t> lengths;
+
+	/* Text of tokens that isn't simply their source text, like invalid literals.
+	 * Sorted by token index. */
+	std::vector<std::pair<uint32_t, std::string_view>> replaced;
+
+	/* The literal id or symbol of every token, see 'Token::payload()'. */
+	std::vector<uint32_t> payloads;
+
+	/* Marks a token type whose text is in 'replaced'.
+	 * Token types never get this large. */
+	static constexpr uint16_t REPLACED = 0x8000;
+
+	/* The source text that the token was built from.
+	 * Literals don't include their quotes. */
+	std::string_view source_text(size_t i) const;
+
+public:
+	/* Creates an empty buffer for the tokens of the given Translation Unit. */
+	explicit TokenBuffer(const TranslationUnit& tu) : tu(&tu) {}
+
+	/* Makes space for 'n' tokens. */
+	void reserve(size_t n);
+
+	/* Adds a token to the end of the buffer. */
+	void push(const Token& tk);
+	/* Adds the tokens from index 'from' up to 'to' of another buffer to the end of this one.
+	 * Both buffers have to be for the same Translation Unit. */
+	void append(const TokenBuffer& other, size_t from, size_t to);
+	/* Replaces the tokens from index 'from' up to 'to' with all of the tokens of another buffer,
+	 * which is for an edited version of this buffer's Translation Unit.
+	 * The tokens after 'to' are moved by 'shift' bytes, and the buffer then belongs to the edited unit. */
+	void splice(size_t from, size_t to, const TokenBuffer& with, int64_t shift);
+
+	/* The number of tokens, including the 'END' token. */
+	inline size_t size() const { return types.size(); }
+
+	/* The type of the token at index 'i'. */
+	inline int type(size_t i) const { return types[i] & ~REPLACED; }
+	/* Where the token at index 'i' starts in the Translation Unit. */
+	inline uint32_t start(size_t i) const { return starts[i]; }
+	/* The length of the token at index 'i' in the source. */
+	inline uint32_t length(size_t i) const { return lengths[i]; }
+	/* Where the token at index 'i' ends in the Translation Unit. */
+	inline uint32_t end(size_t i) const { return starts[i] + lengths[i]; }
+	/* The index of the token that ends at 'pos', if any. */
+	std::optional<size_t> ending_at(uint32_t pos) const;
+
+	/* The text of the token at index 'i', the same as 'Token::raw()'. */
+	std::string_view raw(size_t i) const;
+	/* The span of the token at index 'i'. */
+	Span span(size_t i) const;
+	/* The id of the decoded value of the literal token at index 'i'. */
+	inline LiteralId literal(size_t i) const { return payloads[i]; }
+	/* The interned name of the identifier or lifetime token at index 'i'. */
+	inline Symbol symbol(size_t i) const { return payloads[i]; }
+	/* Replaces the literal id or symbol of the token at index 'i'. */
+	inline void set_payload(size_t i, uint32_t payload) { payloads[i] = payload; }
+
+	/* Rebuilds the token at index 'i'.
+	 * Indices past the end give the 'END' token. */
+	Token token(size_t i) const;
+
+	/* The Translation Unit the tokens were read from. */
+	inline const TranslationUnit& trans_unit() const { return *tu; }
+};
\ No newline at end of file
@@ -113,5 +113,8 @@ enum class TokenType {
 	UNKNOWN
 };
 
+/* The number of token types, counting single character tokens. */
+constexpr int TOKEN_TYPES = (int)TokenType::UNKNOWN + 1;
+
 bool operator==(int type, const TokenType& other);
 bool operator!=(int type, const TokenType& other);
\ No newline at end of file
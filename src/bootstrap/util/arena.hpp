@@ -0,0 +1,118 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Hands out memory from large blocks, which are all freed at once with the arena.
+ * Nothing that's handed out ever moves.
+ * Not safe to use from several threads at once. */
+class Arena {
+
+private:
+	std::vector<std::unique_ptr<char[]>> blocks;
+	/* The unused end of the current block. */
+	char* free = nullptr;
+	size_t left = 0;
+
+	/* The size of a block.
+	 * Anything larger than a quarter of it gets a block of its own. */
+	static constexpr size_t BLOCK_SIZE = 1 << 16;
+
+public:
+	Arena() = default;
+
+	Arena(const Arena& other) = delete;
+	Arena& operator=(const Arena& other) = delete;
+
+	/* Hands out 'n' bytes, aligned to 'align', which is a power of two no larger than 16. */
+	char* allocate(size_t n, size_t align = 1) {
+		// Large allocations would waste most of a shared block
+		if (n > BLOCK_SIZE / 4) {
+			blocks.push_back(std::make_unique<char[]>(n));
+			return blocks.back().get();
+		}
+		size_t pad = -(uintptr_t)free & (align - 1);
+		if (n + pad > left) {
+			blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+			free = blocks.back().get();
+			left = BLOCK_SIZE;
+			pad = 0;
+		}
+		char* mem = free + pad;
+		free += n + pad;
+		left -= n + pad;
+		return mem;
+	}
+
+	/* Constructs an object in the arena.
+	 * Its destructor never runs, so anything it owns has to be in the arena too. */
+	template<typename T, typename... Args>
+	T* make(Args&&... args) {
+		static_assert(alignof(T) <= 16, "arena objects can't be aligned to more than 16 bytes");
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	/* Copies text into the arena. */
+	std::string_view copy(std::string_view text) {
+		if (text.empty())
+			return std::string_view();
+		char* mem = allocate(text.size());
+		memcpy(mem, text.data(), text.size());
+		return std::string_view(mem, text.size());
+	}
+
+	/* The arena that 'ArenaAllocator's use by default on this thread.
+	 * Set it for a while with 'Arena::Use'. */
+	static inline Arena*& current() {
+		thread_local Arena* arena = nullptr;
+		return arena;
+	}
+
+	/* Makes an arena the current one on this thread, until it goes out of scope. */
+	class Use {
+		Arena* previous;
+	public:
+		explicit Use(Arena& arena) : previous(current()) { current() = &arena; }
+		~Use() { current() = previous; }
+
+		Use(const Use& other) = delete;
+		Use& operator=(const Use& other) = delete;
+	};
+};
+
+/* A standard allocator that places containers' elements in an Arena.
+ * Memory is never given back before the arena goes away, so a container
+ * that grows leaves its old elements behind.
+ * Default constructed allocators use the current arena of the thread. */
+template<typename T>
+class ArenaAllocator {
+
+	template<typename U> friend class ArenaAllocator;
+
+	Arena* arena;
+
+public:
+	using value_type = T;
+	// Containers keep using the arena of the elements they take over
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	ArenaAllocator() : arena(Arena::current()) {}
+	explicit ArenaAllocator(Arena& arena) : arena(&arena) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	inline T* allocate(size_t n) { return (T*)arena->allocate(n * sizeof(T), alignof(T)); }
+	inline void deallocate(T*, size_t) {}
+
+	template<typename U>
+	inline bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template<typename U>
+	inline bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* An array that grows in blocks which double in size, so elements never move.
+ * Blocks are only allocated once an index in them is claimed.
+ * Different indices can be claimed from several threads at once, and an element
+ * can be read on another thread once its index has been handed over to it. */
+template<typename T>
+class BlockArray {
+
+private:
+	/* The first block holds 'FIRST_BLOCK' elements, and every next one twice as many. */
+	static constexpr unsigned FIRST_BLOCK_BITS = 8;
+	static constexpr uint64_t FIRST_BLOCK = 1 << FIRST_BLOCK_BITS;
+	/* Enough blocks for every 32-bit index. */
+	static constexpr unsigned BLOCK_COUNT = 33 - FIRST_BLOCK_BITS;
+
+	std::atomic<T*> blocks[BLOCK_COUNT] = {};
+
+	/* Finds the block an index is in, and where in the block it is. */
+	static inline unsigned locate(uint32_t i, size_t& offset) {
+		// Counting from 'FIRST_BLOCK', every block starts at a power of two
+		uint64_t n = (uint64_t)i + FIRST_BLOCK;
+		unsigned block = 63 - __builtin_clzll(n) - FIRST_BLOCK_BITS;
+		offset = n - (FIRST_BLOCK << block);
+		return block;
+	}
+
+public:
+	BlockArray() = default;
+	~BlockArray() {
+		for (auto& block : blocks)
+			delete[] block.load(std::memory_order_relaxed);
+	}
+
+	BlockArray(const BlockArray& other) = delete;
+	BlockArray& operator=(const BlockArray& other) = delete;
+
+	/* The element at an index that's about to be filled in.
+	 * Allocates its block if it's the first one to be claimed. */
+	T& claim(uint32_t i) {
+		size_t offset;
+		unsigned b = locate(i, offset);
+		T* block = blocks[b].load(std::memory_order_acquire);
+
+		// The first index in a block might not be the first one to need it,
+		// so whoever loses the race to allocate it uses the other block
+		if (block == nullptr) {
+			T* fresh = new T[FIRST_BLOCK << b]();
+			if (blocks[b].compare_exchange_strong(block, fresh, std::memory_order_acq_rel))
+				block = fresh;
+			else
+				delete[] fresh;
+		}
+		return block[offset];
+	}
+
+	/* The element at an index that has been claimed. */
+	inline const T& operator[](uint32_t i) const {
+		size_t offset;
+		unsigned b = locate(i, offset);
+		return blocks[b].load(std::memory_order_relaxed)[offset];
+	}
+	inline T& operator[](uint32_t i) {
+		size_t offset;
+		unsigned b = locate(i, offset);
+		return blocks[b].load(std::memory_order_relaxed)[offset];
+	}
+};
\ No newline at end of file
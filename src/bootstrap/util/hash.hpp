@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+namespace hash {
+
+	/* 64-bit FNV-1a hash of the given bytes.
+	 * Fast enough to run over whole source files, but not meant
+	 * to be collision proof; equal hashes still need a compare. */
+	static inline uint64_t fnv1a(std::string_view bytes) {
+		uint64_t h = 0xcbf29ce484222325ull;
+		for (unsigned char c : bytes) {
+			h ^= c;
+			h *= 0x100000001b3ull;
+		}
+		return h;
+	}
+}
\ No newline at end of file
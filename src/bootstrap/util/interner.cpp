@@ -0,0 +1,52 @@
+#include "interner.hpp"
+#include <algorithm>
+
+void Interner::grow(Shard& shard) {
+	std::vector<Slot> table(std::max<size_t>(shard.table.size() * 2, 64), Slot{ 0, 0 });
+	size_t mask = table.size() - 1;
+
+	for (const Slot& slot : shard.table) {
+		if (slot.index == 0)
+			continue;
+		size_t i = slot.hash & mask;
+		while (table[i].index != 0)
+			i = (i + 1) & mask;
+		table[i] = slot;
+	}
+	shard.table = std::move(table);
+}
+
+Symbol Interner::intern(std::string_view name, uint64_t hash) {
+	// The shard comes from the high bits, the slot from the low bits
+	unsigned s = hash >> (64 - SHARD_BITS);
+	Shard& shard = shards[s];
+
+	std::lock_guard<std::mutex> lock(shard.lock);
+	if ((size_t)shard.count * 2 >= shard.table.size())
+		grow(shard);
+
+	size_t mask = shard.table.size() - 1;
+	for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+		Slot& slot = shard.table[i];
+
+		// The name is new
+		if (slot.index == 0) {
+			uint32_t index = shard.count++;
+			shard.names.claim(index) = shard.text.copy(name);
+			slot = Slot{ (uint32_t)hash, index + 1 };
+			return (index << SHARD_BITS) | s;
+		}
+
+		if (slot.hash == (uint32_t)hash && shard.names[slot.index - 1] == name)
+			return ((slot.index - 1) << SHARD_BITS) | s;
+	}
+}
+
+size_t Interner::size() {
+	size_t n = 0;
+	for (auto& shard : shards) {
+		std::lock_guard<std::mutex> lock(shard.lock);
+		n += shard.count;
+	}
+	return n;
+}
\ No newline at end of file
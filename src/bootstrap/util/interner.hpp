@@ -0,0 +1,78 @@
+#pragma once
+#include "arena.hpp"
+#include "block_array.hpp"
+#include "hash.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/* Identifies an interned name.
+ * Equal names always get the same Symbol, so they can be
+ * compared and hashed as plain integers. */
+using Symbol = uint32_t;
+
+/* Gives every distinct name a Symbol, and keeps a copy of its text.
+ * Split up into shards by the hash of the name, each with its own lock,
+ * so several Lexers can intern names at once.
+ * The text of a Symbol can be read without locking. */
+class Interner {
+
+private:
+	/* The low bits of a Symbol are the shard its name is in. */
+	static constexpr unsigned SHARD_BITS = 4;
+	static constexpr unsigned SHARD_COUNT = 1 << SHARD_BITS;
+
+	/* A slot in a shard's hash table. */
+	struct Slot {
+		/* The low bits of the name's hash.
+		 * Enough to place it in the table, and to skip most compares. */
+		uint32_t hash;
+		/* The index of the name in its shard, plus one.
+		 * Zero if the slot is empty. */
+		uint32_t index;
+	};
+
+	/* A part of the Interner with its own lock.
+	 * Every shard is on its own cache lines, so they don't slow each other down. */
+	struct alignas(64) Shard {
+		std::mutex lock;
+		/* Open addressing table of the names, which is never more than half full.
+		 * Its size is a power of two. */
+		std::vector<Slot> table;
+		/* Every name in the shard, by index. */
+		BlockArray<std::string_view> names;
+		/* The number of names in the shard. */
+		uint32_t count = 0;
+		/* Copies of the names' text. */
+		Arena text;
+	};
+
+	Shard shards[SHARD_COUNT];
+
+	/* Doubles the size of a shard's table. */
+	static void grow(Shard& shard);
+
+public:
+	Interner() = default;
+
+	Interner(const Interner& other) = delete;
+	Interner& operator=(const Interner& other) = delete;
+
+	/* The hash that names are interned by. */
+	static inline uint64_t hash(std::string_view name) { return hash::fnv1a(name); }
+
+	/* Returns the Symbol of a name, adding the name if it's new.
+	 * 'hash' has to be the name's 'Interner::hash()'. */
+	Symbol intern(std::string_view name, uint64_t hash);
+	/* Returns the Symbol of a name, adding the name if it's new. */
+	inline Symbol intern(std::string_view name) { return intern(name, hash(name)); }
+
+	/* The text of a Symbol's name. */
+	inline std::string_view name(Symbol sym) const {
+		return shards[sym & (SHARD_COUNT - 1)].names[sym >> SHARD_BITS];
+	}
+
+	/* The number of distinct names. */
+	size_t size();
+};
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "io_ring.hpp"
+#if defined(__linux__)
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+static int sys_io_uring_setup(unsigned entries, io_uring_params* params) {
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+/* Gets a pointer to a field in a ring mapping. */
+template <typename T>
+static inline T* ring_field(void* map, unsigned offset) {
+	return (T*)((char*)map + offset);
+}
+
+bool IoRing::init(unsigned entries) {
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	ring_fd = sys_io_uring_setup(entries, &params);
+	if (ring_fd < 0)
+		return false;
+
+	sq_entries = params.sq_entries;
+
+	// Both rings might live in a single mapping
+	sq_map_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_map_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single_map && cq_map_len > sq_map_len)
+		sq_map_len = cq_map_len;
+
+	sq_map = mmap(nullptr, sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+	if (sq_map == MAP_FAILED) {
+		sq_map = nullptr;
+		release();
+		return false;
+	}
+
+	if (single_map) {
+		cq_map = sq_map;
+	}
+	else {
+		cq_map = mmap(nullptr, cq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+		if (cq_map == MAP_FAILED) {
+			cq_map = nullptr;
+			release();
+			return false;
+		}
+	}
+
+	sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+	void* sqe_map = mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+	if (sqe_map == MAP_FAILED) {
+		release();
+		return false;
+	}
+	sqes = (io_uring_sqe*)sqe_map;
+
+	sq_head = ring_field<unsigned>(sq_map, params.sq_off.head);
+	sq_tail = ring_field<unsigned>(sq_map, params.sq_off.tail);
+	sq_mask = ring_field<unsigned>(sq_map, params.sq_off.ring_mask);
+	sq_array = ring_field<unsigned>(sq_map, params.sq_off.array);
+
+	cq_head = ring_field<unsigned>(cq_map, params.cq_off.head);
+	cq_tail = ring_field<unsigned>(cq_map, params.cq_off.tail);
+	cq_mask = ring_field<unsigned>(cq_map, params.cq_off.ring_mask);
+	cqes = ring_field<io_uring_cqe>(cq_map, params.cq_off.cqes);
+
+	return true;
+}
+
+void IoRing::release() {
+	if (sqes)
+		munmap(sqes, sqes_len);
+	if (cq_map && cq_map != sq_map)
+		munmap(cq_map, cq_map_len);
+	if (sq_map)
+		munmap(sq_map, sq_map_len);
+	if (ring_fd >= 0)
+		close(ring_fd);
+
+	sqes = nullptr;
+	sq_map = cq_map = nullptr;
+	ring_fd = -1;
+	sq_entries = 0;
+	queued = 0;
+}
+
+io_uring_sqe* IoRing::next_sqe() {
+	if (!ready() || queued == sq_entries)
+		return nullptr;
+
+	// Only this thread writes the tail, the kernel only moves the head
+	unsigned tail = *sq_tail + queued;
+	unsigned index = tail & *sq_mask;
+
+	io_uring_sqe* sqe = &sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sq_array[index] = index;
+	queued++;
+	return sqe;
+}
+
+bool IoRing::submit(unsigned wait) {
+	if (!ready())
+		return false;
+
+	// Publish the new entries to the kernel
+	__atomic_store_n(sq_tail, *sq_tail + queued, __ATOMIC_RELEASE);
+
+	unsigned to_submit = queued;
+	queued = 0;
+
+	while (to_submit > 0 || wait > 0) {
+		unsigned flags = wait > 0 ? IORING_ENTER_GETEVENTS : 0;
+		int ret = sys_io_uring_enter(ring_fd, to_submit, wait, flags);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			// The ring can't be trusted anymore
+			release();
+			return false;
+		}
+
+		to_submit -= (unsigned)ret < to_submit ? (unsigned)ret : to_submit;
+
+		// Check if enough completions have arrived
+		unsigned ready = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) - *cq_head;
+		if (ready >= wait)
+			wait = 0;
+	}
+
+	return true;
+}
+
+bool IoRing::pop(uint64_t& user_data, int& res) {
+	unsigned head = *cq_head;
+	if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+		return false;
+
+	const io_uring_cqe& cqe = cqes[head & *cq_mask];
+	user_data = cqe.user_data;
+	res = cqe.res;
+
+	// Let the kernel reuse the entry
+	__atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+#endif
\ No newline at end of file
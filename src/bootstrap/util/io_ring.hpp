@@ -0,0 +1,74 @@
+#pragma once
+#if defined(__linux__)
+
+#include <linux/io_uring.h>
+#include <cstddef>
+#include <cstdint>
+
+/* A minimal io_uring instance, used through raw system calls.
+ * Supports just what batched file loading needs:
+ * queueing entries, submitting them and reaping their completions.
+ * Entries are submitted in batches of at most 'capacity()'. */
+class IoRing {
+
+private:
+	int ring_fd = -1;
+	unsigned sq_entries = 0;
+
+	/* The submission queue ring and its entries. */
+	void* sq_map = nullptr;
+	size_t sq_map_len = 0;
+	unsigned* sq_head = nullptr;
+	unsigned* sq_tail = nullptr;
+	unsigned* sq_mask = nullptr;
+	unsigned* sq_array = nullptr;
+	io_uring_sqe* sqes = nullptr;
+	size_t sqes_len = 0;
+
+	/* Entries queued since the last submit. */
+	unsigned queued = 0;
+
+	/* The completion queue ring.
+	 * Might share its mapping with the submission queue. */
+	void* cq_map = nullptr;
+	size_t cq_map_len = 0;
+	unsigned* cq_head = nullptr;
+	unsigned* cq_tail = nullptr;
+	unsigned* cq_mask = nullptr;
+	io_uring_cqe* cqes = nullptr;
+
+	/* Unmaps the rings and closes the ring descriptor. */
+	void release();
+
+public:
+	IoRing() = default;
+	~IoRing() { release(); }
+
+	IoRing(const IoRing& other) = delete;
+	IoRing& operator=(const IoRing& other) = delete;
+
+	/* Sets up a ring with room for at least 'entries' submissions.
+	 * Returns false if io_uring isn't available. */
+	bool init(unsigned entries);
+
+	/* True if the ring was set up. */
+	inline bool ready() const		{ return ring_fd >= 0; }
+	/* How many entries can be queued before submitting. */
+	inline unsigned capacity() const	{ return sq_entries; }
+
+	/* Returns a cleared submission entry to fill in.
+	 * Returns a nullptr if the queue is full. */
+	io_uring_sqe* next_sqe();
+
+	/* Submits all of the queued entries,
+	 * then waits until at least 'wait' completions are ready.
+	 * Returns false if the kernel refused the entries,
+	 * in which case the ring is shut down. */
+	bool submit(unsigned wait);
+
+	/* Takes the oldest completion off the queue.
+	 * Returns false if there are none. */
+	bool pop(uint64_t& user_data, int& res);
+};
+
+#endif
\ No newline at end of file
@@ -1,16 +1,69 @@
 #pragma once
 #include "driver/session.hpp"
+#include <array>
+#include <cstdint>
 #include <optional>
+#include <string_view>
 
 namespace range {
 
-	/*	Check if the value is a whitespace. */
-	static inline bool is_whitespace(char c) {
-		return 	c == ' '	||
-				c == '\t'	||
-				c == '\r'	||
-				c == '\n';
+	/* Classes a character can belong to.
+	 * A character can be in several classes at once. */
+	enum CharClass : uint8_t {
+		WHITESPACE	= 1 << 0,
+		IDENT_START	= 1 << 1,
+		IDENT_CONT	= 1 << 2,
+		DEC			= 1 << 3,
+		HEX			= 1 << 4,
+		OPERATOR	= 1 << 5,
+	};
+
+	/* Marks every byte with the classes it belongs to.
+	 * Non-ASCII bytes don't belong to any class. */
+	constexpr std::array<uint8_t, 256> make_char_classes() {
+		std::array<uint8_t, 256> classes = {};
+		for (char c : { ' ', '\t', '\r', '\n' })
+			classes[(unsigned char)c] |= WHITESPACE;
+		for (int c = 'a'; c <= 'z'; c++)
+			classes[c] |= IDENT_START | IDENT_CONT;
+		for (int c = 'A'; c <= 'Z'; c++)
+			classes[c] |= IDENT_START | IDENT_CONT;
+		classes['_'] |= IDENT_START | IDENT_CONT;
+		for (int c = '0'; c <= '9'; c++)
+			classes[c] |= DEC | HEX | IDENT_CONT;
+		for (int c = 'a'; c <= 'f'; c++)
+			classes[c] |= HEX;
+		for (int c = 'A'; c <= 'F'; c++)
+			classes[c] |= HEX;
+		for (char c : std::string_view(",;?(){}[]~#@.:=!+-*/%^&|<>"))
+			classes[(unsigned char)c] |= OPERATOR;
+		return classes;
 	}
+	constexpr std::array<uint8_t, 256> char_classes = make_char_classes();
+
+	/* Maps digits to their values.
+	 * Anything that isn't a digit up to base 16 is 0xFF. */
+	constexpr std::array<uint8_t, 256> make_digit_values() {
+		std::array<uint8_t, 256> values = {};
+		for (auto& v : values)
+			v = 0xFF;
+		for (int c = '0'; c <= '9'; c++)
+			values[c] = c - '0';
+		for (int c = 'a'; c <= 'f'; c++)
+			values[c] = c - 'a' + 10;
+		for (int c = 'A'; c <= 'F'; c++)
+			values[c] = c - 'A' + 10;
+		return values;
+	}
+	constexpr std::array<uint8_t, 256> digit_values = make_digit_values();
+
+	/* Check if the value belongs to any of the given classes. */
+	static inline bool is_class(char c, uint8_t classes) { return char_classes[(unsigned char)c] & classes; }
+
+	/*	Check if the value is a whitespace. */
+	static inline bool is_whitespace(char c) { return is_class(c, WHITESPACE); }
+	/* Check if the value can start an operator or punctuation token. */
+	static inline bool is_operator(char c) { return is_class(c, OPERATOR); }
 
 	/* Check if the given integer can be a chracter.  */
 	static inline bool is_char(unsigned int i) {
@@ -27,13 +80,9 @@ namespace range {
 	/* Check if the value is octal. */
 	static inline bool is_oct(char c) { return in_range(c, '0', '7'); }
 	/* Check if the value is decimal. */
-	static inline bool is_dec(char c) { return in_range(c, '0', '9'); }
+	static inline bool is_dec(char c) { return is_class(c, DEC); }
 	/* Check if the value is hexadecimal. */
-	static inline bool is_hex(char c) {
-		return  in_range(c, '0', '9')	||
-				in_range(c, 'a', 'f')	||
-				in_range(c, 'A', 'F');
-	}
+	static inline bool is_hex(char c) { return is_class(c, HEX); }
 
 	/* Check if the value is a character. */
 	static inline bool is_alpha(char c) { return in_range(c, 'a', 'z') || in_range(c, 'A', 'Z'); }
@@ -41,9 +90,9 @@ namespace range {
 	static inline bool is_alnum(char c) { return is_alpha(c) || is_dec(c); }
 
 	/* Check if the character can start an identifier. */
-	static inline bool is_ident_start(char c) { return is_alpha(c) || c == '_'; }
+	static inline bool is_ident_start(char c) { return is_class(c, IDENT_START); }
 	/* Check if the character can continue an identifier. */
-	static inline bool is_ident_cont(char c) { return is_alnum(c) || c == '_'; }
+	static inline bool is_ident_cont(char c) { return is_class(c, IDENT_CONT); }
 
 	/* Attempts to get a number from a character.
 	 * Checks the character for the right base.
@@ -53,27 +102,7 @@ namespace range {
 		if (base > 36)
 			Session::handler.make_bug("tried to get number in base " + std::to_string(base)).emit();
 
-		if (base == 10) {
-			if (is_dec(c))
-				return c - '0';
-			return std::nullopt;
-		}
-		unsigned int val;
-		if (base < 10) {
-			if (is_dec(c))
-				val = c - '0';
-			else return std::nullopt;
-		}
-		else {
-			if (in_range(c, '0', '9'))
-				val =  c - '0';
-			else if (in_range(c, 'a', 'f'))
-				val = c - 'a' + 10;
-			else if (in_range(c, 'A', 'F'))
-				val = c - 'A' + 10;
-			else return std::nullopt;
-		}
-
+		unsigned int val = digit_values[(unsigned char)c];
 		if (val < base) return val;
 		else return std::nullopt;
 	}
@@ -0,0 +1,265 @@
+#include "scan.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define SCAN_X86 1
+	#include <immintrin.h>
+#endif
+
+namespace scan {
+
+	/* Appends 'base + pos + 1' for every set bit 'pos' in the mask.
+	 * The bits are newline positions relative to 'base'. */
+	static inline void push_mask(unsigned int mask, size_t base, std::vector<size_t>& out) {
+		while (mask) {
+			out.push_back(base + __builtin_ctz(mask) + 1);
+			mask &= mask - 1;
+		}
+	}
+
+	/* Handles whatever is left after the vector loops. */
+	static void line_starts_scalar(const char* begin, const char* it, const char* end, size_t base, std::vector<size_t>& out) {
+		for (; it < end; it++)
+			if (*it == '\n')
+				out.push_back(base + (it - begin) + 1);
+	}
+
+#if SCAN_X86
+
+	/* 16 bytes per step, SSE2 is always there on x86-64. */
+	static void line_starts_sse2(const char* begin, const char* end, size_t base, std::vector<size_t>& out) {
+		const __m128i nl = _mm_set1_epi8('\n');
+		const char* it = begin;
+
+		for (; end - it >= 16; it += 16) {
+			__m128i chunk = _mm_loadu_si128((const __m128i*)it);
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+			push_mask(mask, base + (it - begin), out);
+		}
+		line_starts_scalar(begin, it, end, base, out);
+	}
+
+	/* 32 bytes per step, only called after checking that the CPU has AVX2. */
+	__attribute__((target("avx2")))
+	static void line_starts_avx2(const char* begin, const char* end, size_t base, std::vector<size_t>& out) {
+		const __m256i nl = _mm256_set1_epi8('\n');
+		const char* it = begin;
+
+		for (; end - it >= 32; it += 32) {
+			__m256i chunk = _mm256_loadu_si256((const __m256i*)it);
+			unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl));
+			push_mask(mask, base + (it - begin), out);
+		}
+		line_starts_scalar(begin, it, end, base, out);
+	}
+
+	/* Checked once, the answer doesn't change while running. */
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+
+#endif
+
+	static size_t ascii_prefix_scalar(const char* begin, const char* it, const char* end) {
+		while (it < end && (unsigned char)*it < 0x80)
+			it++;
+		return it - begin;
+	}
+
+#if SCAN_X86
+
+	static size_t ascii_prefix_sse2(const char* begin, const char* end) {
+		const char* it = begin;
+		for (; end - it >= 16; it += 16) {
+			// The top bit of every byte is set only for non-ASCII bytes
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)it));
+			if (mask)
+				return (it - begin) + __builtin_ctz(mask);
+		}
+		return ascii_prefix_scalar(begin, it, end);
+	}
+
+	__attribute__((target("avx2")))
+	static size_t ascii_prefix_avx2(const char* begin, const char* end) {
+		const char* it = begin;
+		for (; end - it >= 32; it += 32) {
+			unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)it));
+			if (mask)
+				return (it - begin) + __builtin_ctz(mask);
+		}
+		return ascii_prefix_scalar(begin, it, end);
+	}
+
+#endif
+
+	static size_t find_byte_scalar(const char* begin, const char* it, const char* end, char c) {
+		while (it < end && *it != c)
+			it++;
+		return it - begin;
+	}
+
+	static size_t find_pair_scalar(const char* begin, const char* it, const char* end, char a, char b) {
+		for (; end - it >= 2; it++)
+			if (it[0] == a && it[1] == b)
+				return it - begin;
+		return end - begin;
+	}
+
+	static size_t whitespace_prefix_scalar(const char* begin, const char* it, const char* end) {
+		while (it < end && (*it == ' ' || *it == '\t' || *it == '\r' || *it == '\n'))
+			it++;
+		return it - begin;
+	}
+
+#if SCAN_X86
+
+	static size_t find_byte_sse2(const char* begin, const char* end, char c) {
+		const __m128i needle = _mm_set1_epi8(c);
+		const char* it = begin;
+		for (; end - it >= 16; it += 16) {
+			__m128i chunk = _mm_loadu_si128((const __m128i*)it);
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+			if (mask)
+				return (it - begin) + __builtin_ctz(mask);
+		}
+		return find_byte_scalar(begin, it, end, c);
+	}
+
+	__attribute__((target("avx2")))
+	static size_t find_byte_avx2(const char* begin, const char* end, char c) {
+		const __m256i needle = _mm256_set1_epi8(c);
+		const char* it = begin;
+		for (; end - it >= 32; it += 32) {
+			__m256i chunk = _mm256_loadu_si256((const __m256i*)it);
+			unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+			if (mask)
+				return (it - begin) + __builtin_ctz(mask);
+		}
+		return find_byte_scalar(begin, it, end, c);
+	}
+
+	static size_t find_pair_sse2(const char* begin, const char* end, char a, char b) {
+		const __m128i first = _mm_set1_epi8(a);
+		const __m128i second = _mm_set1_epi8(b);
+		const char* it = begin;
+		// The second load reaches one byte further than the first
+		for (; end - it >= 17; it += 16) {
+			__m128i at_a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)it), first);
+			__m128i at_b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(it + 1)), second);
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(at_a, at_b));
+			if (mask)
+				return (it - begin) + __builtin_ctz(mask);
+		}
+		return find_pair_scalar(begin, it, end, a, b);
+	}
+
+	__attribute__((target("avx2")))
+	static size_t find_pair_avx2(const char* begin, const char* end, char a, char b) {
+		const __m256i first = _mm256_set1_epi8(a);
+		const __m256i second = _mm256_set1_epi8(b);
+		const char* it = begin;
+		for (; end - it >= 33; it += 32) {
+			__m256i at_a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)it), first);
+			__m256i at_b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(it + 1)), second);
+			unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(at_a, at_b));
+			if (mask)
+				return (it - begin) + __builtin_ctz(mask);
+		}
+		return find_pair_scalar(begin, it, end, a, b);
+	}
+
+	static size_t whitespace_prefix_sse2(const char* begin, const char* end) {
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i nl = _mm_set1_epi8('\n');
+		const char* it = begin;
+		for (; end - it >= 16; it += 16) {
+			__m128i chunk = _mm_loadu_si128((const __m128i*)it);
+			__m128i ws = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, nl)));
+			// Set bits are the bytes that aren't whitespace
+			unsigned int mask = ~(unsigned int)_mm_movemask_epi8(ws) & 0xFFFF;
+			if (mask)
+				return (it - begin) + __builtin_ctz(mask);
+		}
+		return whitespace_prefix_scalar(begin, it, end);
+	}
+
+	__attribute__((target("avx2")))
+	static size_t whitespace_prefix_avx2(const char* begin, const char* end) {
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i tab = _mm256_set1_epi8('\t');
+		const __m256i cr = _mm256_set1_epi8('\r');
+		const __m256i nl = _mm256_set1_epi8('\n');
+		const char* it = begin;
+		for (; end - it >= 32; it += 32) {
+			__m256i chunk = _mm256_loadu_si256((const __m256i*)it);
+			__m256i ws = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(chunk, cr), _mm256_cmpeq_epi8(chunk, nl)));
+			unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(ws);
+			if (mask)
+				return (it - begin) + __builtin_ctz(mask);
+		}
+		return whitespace_prefix_scalar(begin, it, end);
+	}
+
+#endif
+
+	void line_starts(std::string_view text, size_t base, std::vector<size_t>& out) {
+		const char* begin = text.data();
+		const char* end = begin + text.size();
+
+#if SCAN_X86
+		if (has_avx2)
+			line_starts_avx2(begin, end, base, out);
+		else
+			line_starts_sse2(begin, end, base, out);
+#else
+		line_starts_scalar(begin, begin, end, base, out);
+#endif
+	}
+
+	size_t ascii_prefix(std::string_view text) {
+		const char* begin = text.data();
+		const char* end = begin + text.size();
+
+#if SCAN_X86
+		return has_avx2 ? ascii_prefix_avx2(begin, end) : ascii_prefix_sse2(begin, end);
+#else
+		return ascii_prefix_scalar(begin, begin, end);
+#endif
+	}
+
+	size_t find_byte(std::string_view text, char c) {
+		const char* begin = text.data();
+		const char* end = begin + text.size();
+
+#if SCAN_X86
+		return has_avx2 ? find_byte_avx2(begin, end, c) : find_byte_sse2(begin, end, c);
+#else
+		return find_byte_scalar(begin, begin, end, c);
+#endif
+	}
+
+	size_t find_pair(std::string_view text, char a, char b) {
+		const char* begin = text.data();
+		const char* end = begin + text.size();
+
+#if SCAN_X86
+		return has_avx2 ? find_pair_avx2(begin, end, a, b) : find_pair_sse2(begin, end, a, b);
+#else
+		return find_pair_scalar(begin, begin, end, a, b);
+#endif
+	}
+
+	size_t whitespace_prefix(std::string_view text) {
+		const char* begin = text.data();
+		const char* end = begin + text.size();
+
+#if SCAN_X86
+		return has_avx2 ? whitespace_prefix_avx2(begin, end) : whitespace_prefix_sse2(begin, end);
+#else
+		return whitespace_prefix_scalar(begin, begin, end);
+#endif
+	}
+}
\ No newline at end of file
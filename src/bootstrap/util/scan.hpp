@@ -0,0 +1,30 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+/* Vectorized scans over source text.
+ * Uses AVX2 when the CPU supports it, SSE2 on any other x86-64 CPU
+ * and plain byte loops everywhere else. */
+namespace scan {
+
+	/* Finds the start of every line after the first one.
+	 * Appends the position following each '\n' in the text to 'out',
+	 * with 'base' added to every position. */
+	void line_starts(std::string_view text, size_t base, std::vector<size_t>& out);
+
+	/* Returns the length of the text before its first non-ASCII byte.
+	 * Returns the text's size if it's all ASCII. */
+	size_t ascii_prefix(std::string_view text);
+
+	/* Returns the position of the first 'c' in the text.
+	 * Returns the text's size if there's none. */
+	size_t find_byte(std::string_view text, char c);
+
+	/* Returns the position of the first 'a' that's directly followed by 'b'.
+	 * Returns the text's size if there's none. */
+	size_t find_pair(std::string_view text, char a, char b);
+
+	/* Returns the length of the whitespace at the start of the text.
+	 * Whitespace is ' ', '\t', '\r' and '\n'. */
+	size_t whitespace_prefix(std::string_view text);
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+#include "arena.hpp"
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+/* Counts how often the SmallVecs of one kind outgrow their inline space.
+ * Only counts while 'enabled' is set, so normal runs don't pay for it. */
+struct SpillCounter {
+	const char* name;
+	/* Containers that had at least one element. */
+	std::atomic<uint64_t> used = 0;
+	/* Containers that had to move their elements into the arena. */
+	std::atomic<uint64_t> spilled = 0;
+
+	explicit SpillCounter(const char* name) : name(name) {}
+
+	static inline bool enabled = false;
+};
+
+/* A vector that keeps up to 'N' elements inside of itself.
+ * Larger vectors move into the Arena that's current on the thread,
+ * which is never given back, just like with an ArenaAllocator.
+ * 'counter', if given, records how often that happens. */
+template<typename T, uint32_t N, SpillCounter* counter = nullptr>
+class SmallVec {
+
+	static_assert(N > 0, "a SmallVec needs some inline space");
+
+private:
+	T* items;
+	uint32_t len = 0;
+	uint32_t cap = N;
+	alignas(T) char local[N * sizeof(T)];
+
+	inline bool is_inline() const { return items == (const T*)local; }
+
+	/* Moves the elements into a larger block of the arena. */
+	void grow() {
+		if (counter && SpillCounter::enabled && is_inline())
+			counter->spilled.fetch_add(1, std::memory_order_relaxed);
+
+		uint32_t new_cap = cap * 2;
+		T* fresh = (T*)Arena::current()->allocate(new_cap * sizeof(T), alignof(T));
+		for (uint32_t i = 0; i < len; i++) {
+			new (&fresh[i]) T(std::move(items[i]));
+			items[i].~T();
+		}
+		items = fresh;
+		cap = new_cap;
+	}
+
+	/* Takes the elements of another vector, leaving it empty. */
+	void take(SmallVec& other) {
+		if (other.is_inline()) {
+			items = (T*)local;
+			cap = N;
+			for (uint32_t i = 0; i < other.len; i++) {
+				new (&items[i]) T(std::move(other.items[i]));
+				other.items[i].~T();
+			}
+		}
+		else {
+			items = other.items;
+			cap = other.cap;
+		}
+		len = other.len;
+		other.items = (T*)other.local;
+		other.len = 0;
+		other.cap = N;
+	}
+
+public:
+	SmallVec() : items((T*)local) {}
+	~SmallVec() { clear(); }
+
+	SmallVec(SmallVec&& other) : items((T*)local) { take(other); }
+	SmallVec& operator=(SmallVec&& other) {
+		if (this != &other) {
+			clear();
+			take(other);
+		}
+		return *this;
+	}
+
+	SmallVec(const SmallVec& other) = delete;
+	SmallVec& operator=(const SmallVec& other) = delete;
+
+	void push_back(T&& item) {
+		if (len == cap)
+			grow();
+		else if (len == 0 && counter && SpillCounter::enabled)
+			counter->used.fetch_add(1, std::memory_order_relaxed);
+		new (&items[len++]) T(std::move(item));
+	}
+
+	void push_back(const T& item) { push_back(T(item)); }
+
+	template<typename... Args>
+	T& emplace_back(Args&&... args) {
+		push_back(T(std::forward<Args>(args)...));
+		return back();
+	}
+
+	/* Makes room for 'n' elements. */
+	void reserve(uint32_t n) {
+		while (cap < n)
+			grow();
+	}
+
+	void clear() {
+		for (uint32_t i = 0; i < len; i++)
+			items[i].~T();
+		len = 0;
+	}
+
+	inline uint32_t size() const { return len; }
+	inline bool empty() const { return len == 0; }
+
+	inline T& operator[](uint32_t i) { return items[i]; }
+	inline const T& operator[](uint32_t i) const { return items[i]; }
+	inline T& back() { return items[len - 1]; }
+	inline const T& back() const { return items[len - 1]; }
+
+	inline T* begin() { return items; }
+	inline T* end() { return items + len; }
+	inline const T* begin() const { return items; }
+	inline const T* end() const { return items + len; }
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <thread>
+
+/* A bounded queue between exactly one producer thread and one consumer thread.
+ * Neither side ever takes a lock. A producer that gets ahead waits for space,
+ * so the queue never holds more than its capacity.
+ * Either side can close the queue to tell the other one to stop waiting. */
+template<class T>
+class SpscRing {
+
+private:
+	/* Keeps the two sides' positions on separate cache lines,
+	 * so they don't slow each other down. */
+	static constexpr size_t CACHE_LINE = 64;
+
+	/* Number of slots, always a power of two. */
+	size_t capacity;
+	/* The slots, indexed by position modulo the capacity. */
+	std::unique_ptr<T[]> slots;
+
+	/* Position of the next item to pop. Only the consumer moves it. */
+	alignas(CACHE_LINE) std::atomic<size_t> head = 0;
+	/* The consumer's last look at 'tail'. */
+	size_t cached_tail = 0;
+
+	/* Position of the next item to push. Only the producer moves it. */
+	alignas(CACHE_LINE) std::atomic<size_t> tail = 0;
+	/* The producer's last look at 'head'. */
+	size_t cached_head = 0;
+
+	/* Set once either side has stopped. */
+	alignas(CACHE_LINE) std::atomic<bool> closed = false;
+
+	/* Waits a little for the other side.
+	 * Spins at first, then gives up the core, which also lets both sides share one. */
+	static inline void backoff(unsigned& spins) {
+		if (++spins < 64)
+			return;
+		std::this_thread::yield();
+	}
+
+public:
+	/* Creates a queue that holds at least 'min_capacity' items. */
+	explicit SpscRing(size_t min_capacity) : capacity(1) {
+		while (capacity < min_capacity)
+			capacity *= 2;
+		slots = std::make_unique<T[]>(capacity);
+	}
+
+	SpscRing(const SpscRing& other) = delete;
+	SpscRing& operator=(const SpscRing& other) = delete;
+
+	/* Adds an item, waiting while the queue is full.
+	 * Only called by the producer.
+	 * Returns false if the queue was closed, in which case the item is dropped. */
+	bool push(const T& item) {
+		size_t pos = tail.load(std::memory_order_relaxed);
+		unsigned spins = 0;
+		while (pos - cached_head == capacity) {
+			if (closed.load(std::memory_order_acquire))
+				return false;
+			cached_head = head.load(std::memory_order_acquire);
+			if (pos - cached_head == capacity)
+				backoff(spins);
+		}
+
+		slots[pos & (capacity - 1)] = item;
+		tail.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* Takes the oldest item, waiting while the queue is empty.
+	 * Only called by the consumer.
+	 * Returns nothing once the queue is closed and every item has been taken. */
+	std::optional<T> pop() {
+		size_t pos = head.load(std::memory_order_relaxed);
+		unsigned spins = 0;
+		while (pos == cached_tail) {
+			cached_tail = tail.load(std::memory_order_acquire);
+			if (pos != cached_tail)
+				break;
+			// Items pushed before closing are still handed out
+			if (closed.load(std::memory_order_acquire)) {
+				cached_tail = tail.load(std::memory_order_acquire);
+				if (pos == cached_tail)
+					return std::nullopt;
+				break;
+			}
+			backoff(spins);
+		}
+
+		T item = slots[pos & (capacity - 1)];
+		head.store(pos + 1, std::memory_order_release);
+		return item;
+	}
+
+	/* Tells the other side to stop waiting.
+	 * Items that were already pushed can still be popped. */
+	void close() { closed.store(true, std::memory_order_release); }
+};
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "utf8.hpp"
+#include "scan.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define UTF8_X86 1
+	#include <immintrin.h>
+#endif
+
+namespace utf8 {
+
+	/* Checks a single non-ASCII sequence.
+	 * Returns its length if it's valid, 0 if it's invalid,
+	 * or -1 if the text ends before the sequence does. */
+	static int check_sequence(const unsigned char* p, size_t avail, uint32_t& cp) {
+		int len = sequence_length(p[0]);
+		if (len == 0)
+			return 0;
+
+		// The second byte has a narrower range after some lead bytes,
+		// which rules out overlong forms, surrogates and values past U+10FFFF
+		unsigned char lo = 0x80, hi = 0xBF;
+		switch (p[0]) {
+			case 0xE0: lo = 0xA0; break;
+			case 0xED: hi = 0x9F; break;
+			case 0xF0: lo = 0x90; break;
+			case 0xF4: hi = 0x8F; break;
+		}
+
+		for (int i = 1; i < len; i++) {
+			if ((size_t)i >= avail)
+				return -1;
+			unsigned char c = p[i];
+			if (i == 1 ? (c < lo || c > hi) : !is_continuation(c))
+				return 0;
+		}
+
+		switch (len) {
+			case 2: cp = ((p[0] & 0x1F) << 6) | (p[1] & 0x3F); break;
+			case 3: cp = ((p[0] & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F); break;
+			case 4: cp = ((p[0] & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F); break;
+		}
+		return len;
+	}
+
+#if UTF8_X86
+
+	/* Checks whole 32 byte blocks, following the lookup method of Keiser and Lemire.
+	 * Every byte is classified together with the one before it through three table
+	 * lookups, which catches bad lead bytes, overlong forms, surrogates and values past
+	 * U+10FFFF. The bytes two and three back tell where continuations are required.
+	 * Returns the start of the first block with an error, or of the text left over.
+	 * A sequence may cross that point, so it's not always the end of the valid text. */
+	__attribute__((target("avx2")))
+	static size_t valid_blocks_avx2(const unsigned char* data, size_t size, bool& ascii) {
+		// Error bits, set for a byte and the one before it
+		constexpr char TOO_SHORT = 1 << 0;		// Lead byte not followed by a continuation
+		constexpr char TOO_LONG = 1 << 1;		// ASCII followed by a continuation
+		constexpr char OVERLONG_3 = 1 << 2;		// 11100000 100_____
+		constexpr char TOO_LARGE = 1 << 3;		// Past U+10FFFF
+		constexpr char SURROGATE = 1 << 4;		// 11101101 101_____
+		constexpr char OVERLONG_2 = 1 << 5;		// 1100000_ 10______
+		constexpr char TOO_LARGE_1000 = 1 << 6;	// Past U+10FFFF, with 1000____ second
+		constexpr char OVERLONG_4 = 1 << 6;		// 11110000 1000____
+		constexpr char TWO_CONTS = (char)(1 << 7);		// Continuation after a continuation
+		constexpr char CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+#define UTF8_TABLE(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+		// Indexed by the high nibble of the previous byte
+		const __m256i byte_1_high = UTF8_TABLE(
+			TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+			TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+			TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+			TOO_SHORT | OVERLONG_2,
+			TOO_SHORT,
+			TOO_SHORT | OVERLONG_3 | SURROGATE,
+			TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+		// Indexed by the low nibble of the previous byte
+		const __m256i byte_1_low = UTF8_TABLE(
+			CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+			CARRY | OVERLONG_2,
+			CARRY,
+			CARRY,
+			CARRY | TOO_LARGE,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+			CARRY | TOO_LARGE | TOO_LARGE_1000,
+			CARRY | TOO_LARGE | TOO_LARGE_1000);
+		// Indexed by the high nibble of the byte itself
+		const __m256i byte_2_high = UTF8_TABLE(
+			TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+			TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+			TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+			TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+			TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+			TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+			TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+#undef UTF8_TABLE
+
+		const __m256i nibble = _mm256_set1_epi8(0x0F);
+		const __m256i high_bit = _mm256_set1_epi8((char)0x80);
+		// Saturating subtraction leaves the top bit set only for 111_____ and 1111____
+		const __m256i third_byte = _mm256_set1_epi8(0xE0 - 0x80);
+		const __m256i fourth_byte = _mm256_set1_epi8(0xF0 - 0x80);
+
+		// The text before the first block counts as ASCII
+		__m256i prev = _mm256_setzero_si256();
+		__m256i seen = _mm256_setzero_si256();
+
+		size_t i = 0;
+		for (; size - i >= 32; i += 32) {
+			__m256i input = _mm256_loadu_si256((const __m256i*)(data + i));
+
+			// The bytes 1, 2 and 3 positions back, reaching into the previous block
+			__m256i carried = _mm256_permute2x128_si256(prev, input, 0x21);
+			__m256i prev1 = _mm256_alignr_epi8(input, carried, 15);
+			__m256i prev2 = _mm256_alignr_epi8(input, carried, 14);
+			__m256i prev3 = _mm256_alignr_epi8(input, carried, 13);
+
+			__m256i special = _mm256_and_si256(
+				_mm256_and_si256(
+					_mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+					_mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+				_mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+			// Third and fourth bytes have to be continuations, where nothing else may be one
+			__m256i must_continue = _mm256_and_si256(
+				_mm256_or_si256(_mm256_subs_epu8(prev2, third_byte), _mm256_subs_epu8(prev3, fourth_byte)),
+				high_bit);
+			__m256i error = _mm256_xor_si256(must_continue, special);
+
+			if (!_mm256_testz_si256(error, error))
+				break;
+
+			seen = _mm256_or_si256(seen, input);
+			prev = input;
+		}
+
+		ascii = _mm256_movemask_epi8(seen) == 0;
+		return i;
+	}
+
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+
+#endif
+
+	Validation validate(std::string_view text) {
+		const unsigned char* data = (const unsigned char*)text.data();
+		size_t size = text.size();
+		bool ascii = true;
+
+		size_t i = 0;
+#if UTF8_X86
+		if (has_avx2) {
+			size_t checked = valid_blocks_avx2(data, size, ascii);
+			if (checked > 0) {
+				// The blocks are valid up to the last sequence that starts before 'checked',
+				// which may continue past it, so check again from there
+				i = checked;
+				while (checked - i < 4 && is_continuation(data[i - 1]))
+					i--;
+				if (i > 0 && data[i - 1] >= 0xC0)
+					i--;
+			}
+		}
+#endif
+		while (i < size) {
+			// Skip ASCII in large steps
+			i += scan::ascii_prefix(text.substr(i));
+			if (i >= size)
+				break;
+			ascii = false;
+
+			// Check the non-ASCII run one sequence at a time
+			while (i < size && data[i] >= 0x80) {
+				uint32_t cp;
+				int len = check_sequence(data + i, size - i, cp);
+				if (len <= 0)
+					return Validation{ i, len < 0, ascii };
+				i += len;
+			}
+		}
+
+		return Validation{ size, false, ascii };
+	}
+
+	int decode(std::string_view text, uint32_t& cp) {
+		if (text.empty()) {
+			cp = 0;
+			return 0;
+		}
+
+		const unsigned char* data = (const unsigned char*)text.data();
+		if (data[0] < 0x80) {
+			cp = data[0];
+			return 1;
+		}
+
+		int len = check_sequence(data, text.size(), cp);
+		if (len <= 0) {
+			cp = REPLACEMENT;
+			return 1;
+		}
+		return len;
+	}
+
+	int encode(uint32_t cp, char* out) {
+		if (cp < 0x80) {
+			out[0] = (char)cp;
+			return 1;
+		}
+		if (cp < 0x800) {
+			out[0] = (char)(0xC0 | (cp >> 6));
+			out[1] = (char)(0x80 | (cp & 0x3F));
+			return 2;
+		}
+		if (cp < 0x10000) {
+			out[0] = (char)(0xE0 | (cp >> 12));
+			out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+			out[2] = (char)(0x80 | (cp & 0x3F));
+			return 3;
+		}
+		out[0] = (char)(0xF0 | (cp >> 18));
+		out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+		out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+		out[3] = (char)(0x80 | (cp & 0x3F));
+		return 4;
+	}
+
+	size_t count(std::string_view text) {
+		// Every byte that isn't a continuation starts a code point
+		size_t n = 0;
+		for (unsigned char c : text)
+			n += !is_continuation(c);
+		return n;
+	}
+
+	/* A range of code points. */
+	struct CodeRange {
+		uint32_t lo;
+		uint32_t hi;
+	};
+
+	/* Letters of the commonly used scripts. */
+	static constexpr CodeRange IDENT_START[] = {
+		{ 0x00AA, 0x00AA }, { 0x00B5, 0x00B5 }, { 0x00BA, 0x00BA },
+		{ 0x00C0, 0x00D6 }, { 0x00D8, 0x00F6 }, { 0x00F8, 0x02FF },	// Latin
+		{ 0x0370, 0x037D }, { 0x037F, 0x03FF },						// Greek
+		{ 0x0400, 0x052F },											// Cyrillic
+		{ 0x0531, 0x0587 },											// Armenian
+		{ 0x05D0, 0x05EA },											// Hebrew
+		{ 0x0620, 0x064A }, { 0x0671, 0x06D3 },						// Arabic
+		{ 0x0900, 0x0DFF },											// Indic scripts
+		{ 0x0E01, 0x0E30 },											// Thai
+		{ 0x10A0, 0x10FF },											// Georgian
+		{ 0x1100, 0x11FF },											// Hangul Jamo
+		{ 0x1E00, 0x1FFF },											// Latin and Greek extended
+		{ 0x3041, 0x3096 }, { 0x30A1, 0x30FA },						// Hiragana, Katakana
+		{ 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF },						// CJK
+		{ 0xAC00, 0xD7A3 },											// Hangul
+		{ 0xF900, 0xFAFF },											// CJK compatibility
+		{ 0x20000, 0x2FA1F },										// CJK extensions
+	};
+
+	/* Marks and digits that can only continue an identifier. */
+	static constexpr CodeRange IDENT_CONT[] = {
+		{ 0x0300, 0x036F },											// Combining marks
+		{ 0x0483, 0x0487 },
+		{ 0x0591, 0x05BD },
+		{ 0x0610, 0x061A }, { 0x064B, 0x0669 },
+		{ 0x1DC0, 0x1DFF },
+		{ 0x203F, 0x2040 },											// Connectors
+		{ 0x20D0, 0x20FF },
+		{ 0xFE20, 0xFE2F },
+	};
+
+	template <size_t N>
+	static bool in_ranges(const CodeRange (&ranges)[N], uint32_t cp) {
+		for (const auto& r : ranges)
+			if (r.lo <= cp && cp <= r.hi)
+				return true;
+		return false;
+	}
+
+	bool is_ident_start(uint32_t cp) {
+		return cp >= 0x80 && in_ranges(IDENT_START, cp);
+	}
+
+	bool is_ident_cont(uint32_t cp) {
+		return is_ident_start(cp) || in_ranges(IDENT_CONT, cp);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+/* Decoding and checking of UTF-8 text.
+ * Source code is expected to be valid UTF-8. Most of it is plain ASCII,
+ * so checks skip over ASCII with vectorized scans and only decode the rest. */
+namespace utf8 {
+
+	/* The code point used in place of invalid sequences. */
+	constexpr uint32_t REPLACEMENT = 0xFFFD;
+
+	/* The result of checking a piece of text. */
+	struct Validation {
+		/* Length of the valid text from the start. */
+		size_t valid;
+		/* True if the check stopped at a sequence that was cut off by the end of the text.
+		 * The sequence might still turn out valid if more text follows. */
+		bool truncated;
+		/* True if all of the valid text is ASCII. */
+		bool ascii;
+	};
+
+	/* Returns the length of a sequence from its first byte.
+	 * Returns 0 if the byte can't start a sequence. */
+	static inline int sequence_length(unsigned char lead) {
+		if (lead < 0x80) return 1;
+		if (lead < 0xC2) return 0;
+		if (lead < 0xE0) return 2;
+		if (lead < 0xF0) return 3;
+		if (lead < 0xF5) return 4;
+		return 0;
+	}
+
+	/* True if the byte continues a sequence, rather than starting one. */
+	static inline bool is_continuation(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+	/* Checks that the text is valid UTF-8. */
+	Validation validate(std::string_view text);
+
+	/* Decodes the code point at the start of the text into 'cp'.
+	 * Returns the length of its sequence.
+	 * Invalid sequences are decoded as a one byte long 'REPLACEMENT'. */
+	int decode(std::string_view text, uint32_t& cp);
+
+	/* True if the code point can be encoded, so it's not past the end of Unicode or a surrogate. */
+	static inline bool is_scalar(uint32_t cp) { return cp < 0x110000 && (cp < 0xD800 || cp > 0xDFFF); }
+
+	/* Encodes a code point into 'out', which needs room for 4 bytes.
+	 * Returns the length of its sequence. */
+	int encode(uint32_t cp, char* out);
+
+	/* Returns the number of code points in valid text. */
+	size_t count(std::string_view text);
+
+	/* Check if a non-ASCII code point can start an identifier.
+	 * Covers letters of the commonly used scripts, not all of Unicode. */
+	bool is_ident_start(uint32_t cp);
+	/* Check if a non-ASCII code point can continue an identifier.
+	 * Also allows combining marks and digits of the covered scripts. */
+	bool is_ident_cont(uint32_t cp);
+}
\ No newline at end of file